@@ -21,9 +21,11 @@
 
 namespace sw
 {
+	bool precacheBlit = false;
+
 	Blitter::Blitter()
 	{
-		blitCache = new RoutineCache<State>(1024);
+		blitCache = new RoutineCache<State>(1024, precacheBlit ? "sw-blit" : 0);
 	}
 
 	Blitter::~Blitter()
@@ -1658,6 +1660,7 @@ namespace sw
 		state.sourceFormat = isStencil ? source->getStencilFormat() : source->getFormat(useSourceInternal);
 		state.destFormat = isStencil ? dest->getStencilFormat() : dest->getFormat(useDestInternal);
 		state.destSamples = dest->getSamples();
+		state.hash = state.computeHash();
 
 		criticalSection.lock();
 		Routine *blitRoutine = blitCache->query(state);
@@ -18,6 +18,7 @@
 #include "Surface.hpp"
 #include "RoutineCache.hpp"
 #include "Reactor/Reactor.hpp"
+#include "System/Hash.hpp"
 
 #include <string.h>
 
@@ -63,9 +64,16 @@ namespace sw
 				return memcmp(this, &state, sizeof(State)) == 0;
 			}
 
+			uint64_t computeHash() const
+			{
+				return hash64(this, reinterpret_cast<const char*>(&hash) - reinterpret_cast<const char*>(this));
+			}
+
 			VkFormat sourceFormat;
 			VkFormat destFormat;
 			int destSamples;
+
+			uint64_t hash;   // Of the preceding members
 		};
 
 		struct BlitData
@@ -16,6 +16,7 @@
 
 #include "Polygon.hpp"
 #include "Renderer.hpp"
+#include "Vertex.hpp"
 #include "Vulkan/VkDebug.hpp"
 
 namespace sw
@@ -31,6 +32,32 @@ namespace sw
 		       Clipper::CLIP_FINITE;   // FIXME: xyz finite
 	}
 
+	bool Clipper::insideGuardBand(const Vertex &v0, const Vertex &v1, const Vertex &v2, int clipFlagsOr)
+	{
+		if((clipFlagsOr & ~(CLIP_LEFT | CLIP_RIGHT | CLIP_TOP | CLIP_BOTTOM)) != CLIP_FINITE)
+		{
+			return false;   // Near, far and user planes still need geometric clipping
+		}
+
+		// Coordinates are in 1/16th pixels. Vertices close to w = 0 have saturated
+		// coordinates, and setup converts them to float, so keep them exact.
+		const int limit = 1 << 24;
+
+		int xMin = min(min(v0.X, v1.X), v2.X);
+		int xMax = max(max(v0.X, v1.X), v2.X);
+		int yMin = min(min(v0.Y, v1.Y), v2.Y);
+		int yMax = max(max(v0.Y, v1.Y), v2.Y);
+
+		if(xMin <= -limit || xMax >= limit || yMin <= -limit || yMax >= limit)
+		{
+			return false;
+		}
+
+		// The edge setup multiplies the horizontal extent by the vertical distance
+		// stepped, which must not overflow 32-bit integers.
+		return (int64_t)(xMax - xMin + 16) * (yMax - yMin + 16) < (int64_t)1 << 30;
+	}
+
 	bool Clipper::clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw)
 	{
 		if(clipFlagsOr & CLIP_FRUSTUM)
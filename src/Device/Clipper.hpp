@@ -21,6 +21,7 @@
 namespace sw
 {
 	struct Polygon;
+	struct Vertex;
 	struct DrawCall;
 	struct DrawData;
 
@@ -55,6 +56,11 @@ namespace sw
 		unsigned int computeClipFlags(const float4 &v);
 		bool clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw);
 
+		// Triangles which only cross the left, right, top or bottom planes can skip
+		// clipping when their screen coordinates stay within the guard band, since the
+		// rasterizer scissors them to the viewport.
+		static bool insideGuardBand(const Vertex &v0, const Vertex &v1, const Vertex &v2, int clipFlagsOr);
+
 	private:
 		void clipNear(Polygon &polygon);
 		void clipFar(Polygon &polygon);
@@ -75,7 +75,6 @@ namespace sw
 
 	enum
 	{
-		OUTLINE_RESOLUTION = 8192,   // Maximum vertical resolution of the render target
 		MIPMAP_LEVELS = 14,
 		TEXTURE_IMAGE_UNITS = 16,
 		VERTEX_TEXTURE_IMAGE_UNITS = 16,
@@ -98,6 +97,10 @@ namespace sw
 		RENDERTARGETS = 8,
 		NUM_TEMPORARY_REGISTERS = 4096,
 		MAX_INTERFACE_COMPONENTS = 32 * 4,
+		MAX_CLUSTER_COUNT = 256,   // Maximum number of pixel processing clusters (must be power of 2)
+		MAX_UNIT_COUNT = 256,      // Maximum number of primitive processing units (must be power of 2)
+		VERTEX_CACHE_FOOTPRINT = 192 * 1024,   // Bytes of processed vertices cached per thread, unless configured
+		MAX_VERTEX_CACHE_SIZE = 4096,
 	};
 }
 
@@ -37,6 +37,9 @@ namespace sw
 	bool forceWindowed = false;
 	bool quadLayoutEnabled = false;
 	bool veryEarlyDepthTest = true;
+	bool tileRasterization = false;
+	bool coarseDepthTest = false;
+	bool guardBandClipping = true;           // Only near, far and user planes clip triangles
 	bool complementaryDepthBuffer = false;
 	bool postBlendSRGB = false;
 	bool exactColorRounding = false;
@@ -19,29 +19,53 @@
 
 namespace sw
 {
+	// Keys must provide a precomputed 'hash' member. Lookups hash into
+	// chained buckets, and a linked list in recency order selects the
+	// entry to evict, so both query() and add() take constant time.
 	template<class Key, class Data>
 	class LRUCache
 	{
 	public:
+		struct Statistics
+		{
+			uint64_t lookups;
+			uint64_t probes;           // Entries visited in the hash buckets
+			uint64_t hashCollisions;   // Entries with the same hash as the key, but not equal
+		};
+
 		LRUCache(int n);
 
 		~LRUCache();
 
-		Data *query(const Key &key) const;
-		Data *add(const Key &key, Data *data);
-	
+		Data *query(const Key &key);
+		Data *add(const Key &key, Data *data);   // Replaces the data of an existing key
+
 		int getSize() {return size;}
 		Key &getKey(int i) {return key[i];}
+		Data *getData(int i) {return data[i];}
+		const Statistics &getStatistics() const {return statistics;}
 
 	private:
+		int find(const Key &key) const;
+		void unlink(int i);
+		void linkFront(int i);
+		void removeFromBucket(int i);
+
 		int size;
-		int mask;
-		int top;
 		int fill;
+		int bucketMask;
+
+		int head;   // Most recently used entry
+		int tail;   // Least recently used entry
 
 		Key *key;
-		Key **ref;
 		Data **data;
+		int *prev;      // Recency list
+		int *next;
+		int *chain;     // Next entry in the same bucket
+		int *bucket;    // First entry of each bucket
+
+		mutable Statistics statistics;
 	};
 }
 
@@ -51,19 +75,29 @@ namespace sw
 	LRUCache<Key, Data>::LRUCache(int n)
 	{
 		size = ceilPow2(n);
-		mask = size - 1;
-		top = 0;
 		fill = 0;
+		bucketMask = 2 * size - 1;   // Keeps the load factor at or below one half
+
+		head = -1;
+		tail = -1;
+
+		statistics = {};
 
 		key = new Key[size];
-		ref = new Key*[size];
 		data = new Data*[size];
+		prev = new int[size];
+		next = new int[size];
+		chain = new int[size];
+		bucket = new int[2 * size];
 
 		for(int i = 0; i < size; i++)
 		{
 			data[i] = nullptr;
+		}
 
-			ref[i] = &key[i];
+		for(int i = 0; i < 2 * size; i++)
+		{
+			bucket[i] = -1;
 		}
 	}
 
@@ -73,9 +107,6 @@ namespace sw
 		delete[] key;
 		key = nullptr;
 
-		delete[] ref;
-		ref = nullptr;
-
 		for(int i = 0; i < size; i++)
 		{
 			if(data[i])
@@ -87,58 +118,126 @@ namespace sw
 
 		delete[] data;
 		data = nullptr;
+
+		delete[] prev;
+		delete[] next;
+		delete[] chain;
+		delete[] bucket;
 	}
 
 	template<class Key, class Data>
-	Data *LRUCache<Key, Data>::query(const Key &key) const
+	Data *LRUCache<Key, Data>::query(const Key &key)
 	{
-		for(int i = top; i > top - fill; i--)
+		int i = find(key);
+
+		if(i < 0)
+		{
+			return nullptr;   // Not found
+		}
+
+		if(i != head)
 		{
-			int j = i & mask;
+			unlink(i);
+			linkFront(i);
+		}
+
+		return data[i];
+	}
 
-			if(key == *ref[j])
+	template<class Key, class Data>
+	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
+	{
+		data->bind();
+
+		int i = find(key);
+
+		if(i >= 0)
+		{
+			unlink(i);
+		}
+		else
+		{
+			if(fill < size)
+			{
+				i = fill++;
+			}
+			else
 			{
-				Data *hit = data[j];
+				i = tail;
+				unlink(i);
+				removeFromBucket(i);
+			}
 
-				if(i != top)
-				{
-					// Move one up
-					int k = (j + 1) & mask;
+			this->key[i] = key;
+
+			int b = key.hash & bucketMask;
+			chain[i] = bucket[b];
+			bucket[b] = i;
+		}
+
+		if(this->data[i])
+		{
+			this->data[i]->unbind();
+		}
+
+		this->data[i] = data;
+		linkFront(i);
 
-					Data *swapD = data[k];
-					data[k] = data[j];
-					data[j] = swapD;
+		return data;
+	}
+
+	template<class Key, class Data>
+	int LRUCache<Key, Data>::find(const Key &key) const
+	{
+		statistics.lookups++;
+
+		for(int i = bucket[key.hash & bucketMask]; i >= 0; i = chain[i])
+		{
+			statistics.probes++;
 
-					Key *swapK = ref[k];
-					ref[k] = ref[j];
-					ref[j] = swapK;
+			if(key.hash == this->key[i].hash)
+			{
+				if(key == this->key[i])
+				{
+					return i;
 				}
 
-				return hit;
+				statistics.hashCollisions++;
 			}
 		}
 
-		return nullptr;   // Not found
+		return -1;
 	}
 
 	template<class Key, class Data>
-	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
+	void LRUCache<Key, Data>::unlink(int i)
 	{
-		top = (top + 1) & mask;
-		fill = fill + 1 < size ? fill + 1 : size;
+		if(prev[i] >= 0) next[prev[i]] = next[i]; else head = next[i];
+		if(next[i] >= 0) prev[next[i]] = prev[i]; else tail = prev[i];
+	}
 
-		*ref[top] = key;
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::linkFront(int i)
+	{
+		prev[i] = -1;
+		next[i] = head;
 
-		data->bind();
+		if(head >= 0) prev[head] = i; else tail = i;
 
-		if(this->data[top])
+		head = i;
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::removeFromBucket(int i)
+	{
+		int *link = &bucket[key[i].hash & bucketMask];
+
+		while(*link != i)
 		{
-			this->data[top]->unbind();
+			link = &chain[*link];
 		}
 
-		this->data[top] = data;
-
-		return data;
+		*link = chain[i];
 	}
 }
 
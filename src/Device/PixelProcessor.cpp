@@ -19,6 +19,7 @@
 #include "Pipeline/PixelProgram.hpp"
 #include "Pipeline/PixelShader.hpp"
 #include "Pipeline/Constants.hpp"
+#include "System/Hash.hpp"
 #include "Vulkan/VkDebug.hpp"
 
 #include <string.h>
@@ -31,17 +32,9 @@ namespace sw
 
 	bool precachePixel = false;
 
-	unsigned int PixelProcessor::States::computeHash()
+	uint64_t PixelProcessor::States::computeHash()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
-
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
-		{
-			hash ^= state[i];
-		}
-
-		return hash;
+		return hash64(this, sizeof(States));
 	}
 
 	PixelProcessor::State::State()
@@ -73,6 +66,8 @@ namespace sw
 
 	PixelProcessor::~PixelProcessor()
 	{
+		synchronizeRoutines();   // Pending routines may still reference shaders
+
 		delete routineCache;
 		routineCache = nullptr;
 	}
@@ -617,14 +612,21 @@ namespace sw
 
 	void PixelProcessor::setRoutineCacheSize(int cacheSize)
 	{
+		if(routineCache)
+		{
+			synchronizeRoutines();
+		}
+
 		delete routineCache;
 		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precachePixel ? "sw-pixel" : 0);
 	}
 
-	const PixelProcessor::State PixelProcessor::update() const
+	const PixelProcessor::State PixelProcessor::update(int clusterCount) const
 	{
 		State state;
 
+		state.clusterCount = clusterCount;
+
 		if(context->pixelShader)
 		{
 			state.shaderID = context->pixelShader->getSerialID();
@@ -767,19 +769,36 @@ namespace sw
 
 	Routine *PixelProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		// Shader IDs are process-local, so only routines without a shader can be precached
+		const bool persistent = (state.shaderID == 0);
+		Routine *routine = routineCache->query(state, persistent);
 
 		if(!routine)
 		{
-			const bool integerPipeline = (context->pixelShaderModel() <= 0x0104);
-			QuadRasterizer *generator = new PixelProgram(state, context->pixelShader);
-			generator->generate();
-			routine = (*generator)("PixelRoutine_%0.8X", state.shaderID);
-			delete generator;
+			const PixelShader *shader = context->pixelShader;
 
-			routineCache->add(state, routine);
+			routine = routineCache->generate(state, [state, shader](bool optimize)
+			{
+				QuadRasterizer *generator = new PixelProgram(state, shader);
+				generator->generate();
+				Routine *routine = optimize ? (*generator)("PixelRoutine_%0.8X", state.shaderID) :
+				                              generator->unoptimized("PixelRoutine_%0.8X", state.shaderID);
+				delete generator;
+
+				return routine;
+			}, persistent);
 		}
 
 		return routine;
 	}
+
+	Routine *PixelProcessor::reuse(const State &state, Routine *routine)
+	{
+		return routineCache->use(routine) ? this->routine(state) : routine;
+	}
+
+	void PixelProcessor::synchronizeRoutines()
+	{
+		routineCache->synchronize();
+	}
 }
@@ -30,9 +30,10 @@ namespace sw
 	public:
 		struct States
 		{
-			unsigned int computeHash();
+			uint64_t computeHash();
 
 			int shaderID;
+			int clusterCount;   // Rows or tiles are interleaved between this many clusters
 
 			bool depthOverride                        : 1;   // TODO: Eliminate by querying shader.
 			bool shaderContainsKill                   : 1;   // TODO: Eliminate by querying shader.
@@ -122,7 +123,7 @@ namespace sw
 				return (alphaCompareMode != VK_COMPARE_OP_ALWAYS) || (transparencyAntialiasing != TRANSPARENCY_NONE);
 			}
 
-			unsigned int hash;
+			uint64_t hash;
 		};
 
 		struct Stencil
@@ -255,8 +256,10 @@ namespace sw
 		void setOcclusionEnabled(bool enable);
 
 	protected:
-		const State update() const;
+		const State update(int clusterCount) const;
 		Routine *routine(const State &state);
+		Routine *reuse(const State &state, Routine *routine);   // Counts another draw with the routine of an unchanged state
+		void synchronizeRoutines();   // Waits for background routine generation
 		void setRoutineCacheSize(int routineCacheSize);
 
 		// Shader constants
@@ -63,17 +63,28 @@ namespace sw
 		int64_t clockwiseMask;
 		int64_t invClockwiseMask;
 
-		struct Span
+		// Integer DDA state of an edge at its first scanline, which the rasterizer
+		// steps incrementally. Clipped polygons have at most 16 edges.
+		struct Edge
 		{
-			unsigned short left;
-			unsigned short right;
+			int y1;      // First scanline
+			int y2;      // Scanline past the end
+			int x;       // Span bound at y1
+			int d;       // Error-term
+			int Q;       // Edge-step
+			int R;       // Error-step
+			int D;       // Error-overflow
+			int right;   // Bounds the span on the right
 		};
 
-		// The rasterizer adds a zero length span to the top and bottom of the polygon to allow
-		// for 2x2 pixel processing. We need an even number of spans to keep accesses aligned.
-		Span outlineUnderflow[2];
-		Span outline[OUTLINE_RESOLUTION];
-		Span outlineOverflow[2];
+		// Bounding box of the covered pixels, clipped to the scissor rectangle
+		int yTop;
+		int yBottom;
+		int xMin;
+		int xMax;
+
+		int edgeCount;
+		Edge edge[16];
 	};
 }
 
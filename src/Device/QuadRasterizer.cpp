@@ -25,8 +25,8 @@ namespace sw
 	extern bool veryEarlyDepthTest;
 	extern bool complementaryDepthBuffer;
 	extern bool fullPixelPositionRegister;
-
-	extern int clusterCount;
+	extern bool tileRasterization;
+	extern bool coarseDepthTest;
 
 	QuadRasterizer::QuadRasterizer(const PixelProcessor::State &state, const PixelShader *pixelShader) : state(state), shader(pixelShader)
 	{
@@ -49,17 +49,45 @@ namespace sw
 
 		constants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,constants));
 		occlusion = 0;
-		int clusterCount = Renderer::getClusterCount();
+		clusterCount = state.clusterCount;
 
 		Do
 		{
 			Int yMin = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
 			Int yMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
 
-			Int cluster2 = cluster + cluster;
-			yMin += clusterCount * 2 - 2 - cluster2;
-			yMin &= -clusterCount * 2;
-			yMin += cluster2;
+			if(tileRasterization)
+			{
+				yMin &= -2;
+
+				Int xMin = *Pointer<Int>(primitive + OFFSET(Primitive,xMin));
+				Int xMax = *Pointer<Int>(primitive + OFFSET(Primitive,xMax));
+
+				for(unsigned int q = 1; q < state.multiSample; q++)
+				{
+					xMin = Min(xMin, *Pointer<Int>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,xMin)));
+					xMax = Max(xMax, *Pointer<Int>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,xMax)));
+				}
+
+				tileColumn = xMin >> TILE_SIZE_BITS;
+				tileColumns = ((xMax - 1) >> TILE_SIZE_BITS) - tileColumn + 1;
+
+				// Tiles are assigned to clusters diagonally, so each row further down moves this
+				// cluster's first tile one column to the left. The bounding box contains one of
+				// them if that offset on its first tile row is less than its columns plus rows.
+				Int tileRow = yMin >> TILE_SIZE_BITS;
+				Int tileRows = ((yMax - 1) >> TILE_SIZE_BITS) - tileRow + 1;
+				Int offset = (cluster - tileColumn - tileRow) & (clusterCount - 1);
+
+				yMax = IfThenElse(xMin < xMax && offset < tileColumns + tileRows - 1, yMax, yMin);
+			}
+			else
+			{
+				Int cluster2 = cluster + cluster;
+				yMin += clusterCount * 2 - 2 - cluster2;
+				yMin &= -clusterCount * 2;
+				yMin += cluster2;
+			}
 
 			If(yMin < yMax)
 			{
@@ -114,34 +142,72 @@ namespace sw
 			sBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,stencilBuffer)) + yMin * *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB));
 		}
 
+		EdgeWalker leftEdge[4];
+		EdgeWalker rightEdge[4];
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			Pointer<Byte> sample = primitive + q * sizeof(Primitive);
+
+			startEdge(leftEdge[q], sample, false);
+			startEdge(rightEdge[q], sample, true);
+		}
+
 		Int y = yMin;
 
 		Do
 		{
-			Int x0a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-			Int x0b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
-			Int x0 = Min(x0a, x0b);
-
-			for(unsigned int q = 1; q < state.multiSample; q++)
+			if(tileRasterization)
 			{
-				x0a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-				x0b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
-				x0 = Min(x0, Min(x0a, x0b));
+				// Skip tile rows on which none of the primitive's tile columns belong to this
+				// cluster. The edge walkers catch up on the next visited scanline.
+				While(y < yMax && ((cluster - tileColumn - (y >> TILE_SIZE_BITS)) & (clusterCount - 1)) >= tileColumns)
+				{
+					Int rows = (((y >> TILE_SIZE_BITS) + 1) << TILE_SIZE_BITS) - y;
+					skipRows(cBuffer, zBuffer, sBuffer, rows);
+					y += rows;
+				}
 			}
 
-			x0 &= 0xFFFFFFFE;
+			Int x0 = Int(0x7FFFFFFF);
+			Int x1 = Int(0);
 
-			Int x1a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-			Int x1b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
-			Int x1 = Max(x1a, x1b);
+			Short4 xLeft[4];
+			Short4 xRight[4];
 
-			for(unsigned int q = 1; q < state.multiSample; q++)
+			for(unsigned int q = 0; q < state.multiSample; q++)
 			{
-				x1a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-				x1b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
-				x1 = Max(x1, Max(x1a, x1b));
+				Pointer<Byte> sample = primitive + q * sizeof(Primitive);
+
+				Int xMin = *Pointer<Int>(sample + OFFSET(Primitive,xMin));
+				Int xMax = *Pointer<Int>(sample + OFFSET(Primitive,xMax));
+				Int yTop = *Pointer<Int>(sample + OFFSET(Primitive,yTop));
+				Int yBottom = *Pointer<Int>(sample + OFFSET(Primitive,yBottom));
+
+				Int left0 = Clamp(walkEdge(leftEdge[q], sample, false, y + 0), xMin, xMax);
+				Int right0 = Clamp(walkEdge(rightEdge[q], sample, true, y + 0), xMin, xMax);
+				Int left1 = Clamp(walkEdge(leftEdge[q], sample, false, y + 1), xMin, xMax);
+				Int right1 = Clamp(walkEdge(rightEdge[q], sample, true, y + 1), xMin, xMax);
+
+				// Scanlines outside of the primitive have empty spans
+				right0 = IfThenElse(y + 0 >= yTop && y + 0 < yBottom, right0, left0);
+				right1 = IfThenElse(y + 1 >= yTop && y + 1 < yBottom, right1, left1);
+
+				// Only non-empty spans determine the range of quads to rasterize
+				x0 = IfThenElse(left0 < right0, Min(x0, left0), x0);
+				x1 = IfThenElse(left0 < right0, Max(x1, right0), x1);
+				x0 = IfThenElse(left1 < right1, Min(x0, left1), x0);
+				x1 = IfThenElse(left1 < right1, Max(x1, right1), x1);
+
+				Int4 left = Insert(Insert(Int4(left0), left1, 2), left1, 3);
+				Int4 right = Insert(Insert(Int4(right0), right1, 2), right1, 3);
+
+				xLeft[q] = Short4(left) - Short4(1, 2, 1, 2);
+				xRight[q] = Short4(right) - Short4(0, 1, 0, 1);
 			}
 
+			x0 &= 0xFFFFFFFE;
+
 			Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
 
 			if(interpolateZ())
@@ -159,76 +225,9 @@ namespace sw
 				}
 			}
 
-			if(veryEarlyDepthTest && state.multiSample == 1 && !state.depthOverride)
+			if(!tileRasterization)
 			{
-				if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == VK_COMPARE_OP_LESS_OR_EQUAL || state.depthCompareMode == VK_COMPARE_OP_LESS))   // FIXME: Both modes ok?
-				{
-					Float4 xxxx = Float4(Float(x0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
-
-					Pointer<Byte> buffer;
-					Int pitch;
-
-					if(!state.quadLayoutDepthBuffer)
-					{
-						buffer = zBuffer + 4 * x0;
-						pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
-					}
-					else
-					{
-						buffer = zBuffer + 8 * x0;
-					}
-
-					For(Int x = x0, x < x1, x += 2)
-					{
-						Float4 z = interpolate(xxxx, Dz[0], z, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
-
-						Float4 zValue;
-
-						if(!state.quadLayoutDepthBuffer)
-						{
-							// FIXME: Properly optimizes?
-							zValue.xy = *Pointer<Float4>(buffer);
-							zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
-						}
-						else
-						{
-							zValue = *Pointer<Float4>(buffer, 16);
-						}
-
-						Int4 zTest;
-
-						if(complementaryDepthBuffer)
-						{
-							zTest = CmpLE(zValue, z);
-						}
-						else
-						{
-							zTest = CmpNLT(zValue, z);
-						}
-
-						Int zMask = SignMask(zTest);
-
-						If(zMask == 0)
-						{
-							x0 += 2;
-						}
-						Else
-						{
-							x = x1;
-						}
-
-						xxxx += Float4(2);
-
-						if(!state.quadLayoutDepthBuffer)
-						{
-							buffer += 8;
-						}
-						else
-						{
-							buffer += 16;
-						}
-					}
-				}
+				skipOccludedQuads(zBuffer, x0, x1, y);
 			}
 
 			If(x0 < x1)
@@ -264,56 +263,417 @@ namespace sw
 					}
 				}
 
-				Short4 xLeft[4];
-				Short4 xRight[4];
+				if(tileRasterization)
+				{
+					// Tiles are assigned to clusters diagonally, so find the first tile
+					// owned by this cluster on the current tile row, at or right of x0.
+					Int tileY = y >> TILE_SIZE_BITS;
+					Int tileX = x0 >> TILE_SIZE_BITS;
+					tileX += (cluster - tileX - tileY) & (clusterCount - 1);
+					Int tileLeft = tileX << TILE_SIZE_BITS;
+
+					While(tileLeft < x1)
+					{
+						Int xTile0 = Max(x0, tileLeft);
+						Int xTile1 = Min(x1, tileLeft + TILE_SIZE);
+
+						skipOccludedQuads(zBuffer, xTile0, xTile1, y);
+						rasterizeSpan(cBuffer, zBuffer, sBuffer, xLeft, xRight, xTile0, xTile1, y);
+						tightenCoarseDepth(zBuffer, xTile0, xTile1, y, yMax);
 
-				for(unsigned int q = 0; q < state.multiSample; q++)
+						tileLeft += clusterCount << TILE_SIZE_BITS;
+					}
+				}
+				else
 				{
-					xLeft[q] = *Pointer<Short4>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline) + y * sizeof(Primitive::Span));
-					xRight[q] = xLeft[q];
+					rasterizeSpan(cBuffer, zBuffer, sBuffer, xLeft, xRight, x0, x1, y);
+					tightenCoarseDepth(zBuffer, x0, x1, y, yMax);
+				}
+			}
+
+			// In tile mode every cluster visits each scanline pair, otherwise they're interleaved
+			int rowShift = tileRasterization ? 1 : 1 + sw::log2(clusterCount);
+
+			for(int index = 0; index < RENDERTARGETS; index++)
+			{
+				if(state.colorWriteActive(index))
+				{
+					cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) << rowShift;   // FIXME: Precompute
+				}
+			}
+
+			if(state.depthTestActive)
+			{
+				zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) << rowShift;   // FIXME: Precompute
+			}
+
+			if(state.stencilActive)
+			{
+				sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << rowShift;   // FIXME: Precompute
+			}
+
+			y += 1 << rowShift;
+		}
+		Until(y >= yMax)
+	}
+
+	void QuadRasterizer::skipRows(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int &rows)
+	{
+		for(int index = 0; index < RENDERTARGETS; index++)
+		{
+			if(state.colorWriteActive(index))
+			{
+				cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) * rows;
+			}
+		}
+
+		if(state.depthTestActive)
+		{
+			zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) * rows;
+		}
+
+		if(state.stencilActive)
+		{
+			sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) * rows;
+		}
+	}
+
+	void QuadRasterizer::startEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right)
+	{
+		walker.y = *Pointer<Int>(sample + OFFSET(Primitive,yTop));
+		walker.x = *Pointer<Int>(sample + OFFSET(Primitive,xMin));   // For primitives without edges
+		walker.d = 0;
+
+		nextEdge(walker, sample, right);
+	}
+
+	void QuadRasterizer::nextEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right)
+	{
+		// Edges on the same side of a convex polygon don't overlap vertically,
+		// so the next edge is the one which starts at the walker's scanline.
+		Int count = *Pointer<Int>(sample + OFFSET(Primitive,edgeCount));
+		Int next = count;
+
+		For(Int i = 0, i < count, i++)
+		{
+			Pointer<Byte> edge = sample + OFFSET(Primitive,edge) + i * sizeof(Primitive::Edge);
+
+			If(*Pointer<Int>(edge + OFFSET(Primitive::Edge,y1)) == walker.y && *Pointer<Int>(edge + OFFSET(Primitive::Edge,right)) == Int(right ? 1 : 0))
+			{
+				next = i;
+			}
+		}
+
+		If(next < count)
+		{
+			Pointer<Byte> edge = sample + OFFSET(Primitive,edge) + next * sizeof(Primitive::Edge);
+
+			walker.y2 = *Pointer<Int>(edge + OFFSET(Primitive::Edge,y2));
+			walker.x = *Pointer<Int>(edge + OFFSET(Primitive::Edge,x));
+			walker.d = *Pointer<Int>(edge + OFFSET(Primitive::Edge,d));
+			walker.Q = *Pointer<Int>(edge + OFFSET(Primitive::Edge,Q));
+			walker.R = *Pointer<Int>(edge + OFFSET(Primitive::Edge,R));
+			walker.D = *Pointer<Int>(edge + OFFSET(Primitive::Edge,D));
+		}
+		Else
+		{
+			// Past the bottom of the primitive, x is kept for the empty spans
+			walker.y2 = Int(0x7FFFFFFF);
+			walker.Q = 0;
+			walker.R = 0;
+			walker.D = 0;
+		}
+	}
+
+	Int QuadRasterizer::walkEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right, Int y)
+	{
+		// Scanlines above the primitive use the top of the outline
+		While(walker.y < y)
+		{
+			walker.y += 1;
+
+			If(walker.y < walker.y2)
+			{
+				walker.x += walker.Q;
+				walker.d += walker.R;
+
+				Int overflow = -walker.d >> 31;
+
+				walker.d -= walker.D & overflow;
+				walker.x -= overflow;
+			}
+			Else
+			{
+				nextEdge(walker, sample, right);
+			}
+		}
+
+		return walker.x;
+	}
+
+	void QuadRasterizer::skipOccludedQuads(Pointer<Byte> &zBuffer, Int &x0, Int &x1, Int &y)
+	{
+		if(coarseDepthTest && state.multiSample == 1 && !state.depthOverride && !state.depthClamp)
+		{
+			if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == VK_COMPARE_OP_LESS_OR_EQUAL || state.depthCompareMode == VK_COMPARE_OP_LESS))
+			{
+				skipOccludedTiles(x0, x1, y);
+			}
+		}
+
+		if(veryEarlyDepthTest && state.multiSample == 1 && !state.depthOverride)
+		{
+			if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == VK_COMPARE_OP_LESS_OR_EQUAL || state.depthCompareMode == VK_COMPARE_OP_LESS))   // FIXME: Both modes ok?
+			{
+				Float4 xxxx = Float4(Float(x0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+
+				Pointer<Byte> buffer;
+				Int pitch;
 
-					xLeft[q] = Swizzle(xLeft[q], 0xA0) - Short4(1, 2, 1, 2);
-					xRight[q] = Swizzle(xRight[q], 0xF5) - Short4(0, 1, 0, 1);
+				if(!state.quadLayoutDepthBuffer)
+				{
+					buffer = zBuffer + 4 * x0;
+					pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+				}
+				else
+				{
+					buffer = zBuffer + 8 * x0;
 				}
 
 				For(Int x = x0, x < x1, x += 2)
 				{
-					Short4 xxxx = Short4(x);
-					Int cMask[4];
+					Float4 z = interpolate(xxxx, Dz[0], z, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+
+					Float4 zValue;
+
+					if(!state.quadLayoutDepthBuffer)
+					{
+						// FIXME: Properly optimizes?
+						zValue.xy = *Pointer<Float4>(buffer);
+						zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
+					}
+					else
+					{
+						zValue = *Pointer<Float4>(buffer, 16);
+					}
+
+					Int4 zTest;
 
-					for(unsigned int q = 0; q < state.multiSample; q++)
+					if(complementaryDepthBuffer)
+					{
+						zTest = CmpLE(zValue, z);
+					}
+					else
 					{
-						Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
-						cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+						zTest = CmpNLT(zValue, z);
 					}
 
-					quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
+					Int zMask = SignMask(zTest);
+
+					If(zMask == 0)
+					{
+						x0 += 2;
+					}
+					Else
+					{
+						x = x1;
+					}
+
+					xxxx += Float4(2);
+
+					if(!state.quadLayoutDepthBuffer)
+					{
+						buffer += 8;
+					}
+					else
+					{
+						buffer += 16;
+					}
 				}
 			}
+		}
+	}
 
-			int clusterCount = Renderer::getClusterCount();
+	void QuadRasterizer::skipOccludedTiles(Int &x0, Int &x1, Int &y)
+	{
+		Int coarsePitch = *Pointer<Int>(data + OFFSET(DrawData,coarseDepthPitch));
 
-			for(int index = 0; index < RENDERTARGETS; index++)
+		If(coarsePitch != 0)
+		{
+			const int tileBits = Surface::COARSE_DEPTH_TILE_BITS;
+			const int tileSize = Surface::COARSE_DEPTH_TILE;
+
+			Pointer<Byte> coarseRow = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,coarseDepth)) + (y >> tileBits) * coarsePitch * sizeof(float);
+
+			// The depth of the primitive's nearest pixel in a tile's span is computed with the same
+			// operations, in the same order, as the per-pixel depth. Rounding is monotonic, so the
+			// result is exactly the nearest per-pixel depth. A margin of a few ulps of the terms
+			// keeps the rejection conservative should the backend fuse or reorder the operations,
+			// so that coplanar redraws with an equal depth test never lose pixels.
+			Float A = *Pointer<Float>(primitive + OFFSET(Primitive,z.A));
+			Float B = *Pointer<Float>(primitive + OFFSET(Primitive,z.B));
+			Float C = *Pointer<Float>(primitive + OFFSET(Primitive,z.C));
+			Float4 xQuad = *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+			Float4 yQuad = *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
+
+			// Upper or lower scanline, and the tile's left or right column (the second pixel of its last quad)
+			Bool nearBelow = complementaryDepthBuffer ? B > Float(0.0f) : B < Float(0.0f);
+			Bool nearRight = complementaryDepthBuffer ? A > Float(0.0f) : A < Float(0.0f);
+
+			Float yNear = Float(y) + IfThenElse(nearBelow, Float(Extract(yQuad, 2)), Float(Extract(yQuad, 0)));
+			Float xNear = IfThenElse(nearRight, Float(Extract(xQuad, 1)), Float(Extract(xQuad, 0)));
+			Int xOffset = IfThenElse(nearRight, Int(tileSize - 2), Int(0));
+
+			Float zRow = C + yNear * B;
+
+			// Trim occluded tiles from the left end of the span
+			For(Int x = x0 & -tileSize, x < x1, x += tileSize)
 			{
-				if(state.colorWriteActive(index))
+				Float zColumn = (Float(x + xOffset) + xNear) * A;
+				Float zNear = zRow + zColumn;
+				Float margin = (Abs(zRow) + Abs(zColumn)) * Float(1.0f / (1 << 21));
+				Float zFar = *Pointer<Float>(coarseRow + (x >> tileBits) * sizeof(float));
+
+				If(complementaryDepthBuffer ? zNear + margin < zFar : zNear - margin > zFar)
+				{
+					x0 = x + tileSize;
+				}
+				Else
 				{
-					cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+					x = x1;
 				}
 			}
 
-			if(state.depthTestActive)
+			// Trim occluded tiles from the right end of the span
+			For(Int x = (x1 - 1) & -tileSize, x + tileSize > x0, x -= tileSize)
 			{
-				zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				Float zColumn = (Float(x + xOffset) + xNear) * A;
+				Float zNear = zRow + zColumn;
+				Float margin = (Abs(zRow) + Abs(zColumn)) * Float(1.0f / (1 << 21));
+				Float zFar = *Pointer<Float>(coarseRow + (x >> tileBits) * sizeof(float));
+
+				If(complementaryDepthBuffer ? zNear + margin < zFar : zNear - margin > zFar)
+				{
+					x1 = x;
+				}
+				Else
+				{
+					x = x0 - tileSize;
+				}
 			}
+		}
+	}
 
-			if(state.stencilActive)
+	void QuadRasterizer::tightenCoarseDepth(Pointer<Byte> &zBuffer, Int &x0, Int &x1, Int &y, Int &yMax)
+	{
+		// Depth values only move closer to the viewer under these compare modes, so the farthest
+		// depth read back from a tile at any time remains a valid bound, even when other clusters
+		// are still writing to it. Multisample buffers hold several depths per pixel.
+		if(!coarseDepthTest || state.multiSample != 1 || !state.depthWriteEnable || !state.depthTestActive)
+		{
+			return;
+		}
+
+		if(state.depthCompareMode != VK_COMPARE_OP_LESS_OR_EQUAL && state.depthCompareMode != VK_COMPARE_OP_LESS)
+		{
+			return;
+		}
+
+		const int tileBits = Surface::COARSE_DEPTH_TILE_BITS;
+		const int tileSize = Surface::COARSE_DEPTH_TILE;
+
+		// Only reduce a tile row once its last scanline pair has been rasterized, or the primitive ends in it
+		int rowStep = tileRasterization ? 2 : 2 * clusterCount;
+		Int coarsePitch = *Pointer<Int>(data + OFFSET(DrawData,coarseDepthPitch));
+		Int tilesY = *Pointer<Int>(data + OFFSET(DrawData,coarseDepthTilesY));
+		Bool flush = ((y + 2) & (tileSize - 1)) == 0 || y + rowStep >= yMax;
+
+		If(coarsePitch != 0 && flush && (y >> tileBits) < tilesY)
+		{
+			Int pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+			Pointer<Byte> coarseRow = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,coarseDepth)) + (y >> tileBits) * coarsePitch * sizeof(float);
+			Pointer<Byte> tileRow = zBuffer - (y & (tileSize - 1)) * pitch;
+
+			// Tiles extending past the edges of the depth buffer keep the bound set by clears
+			Int tileX1 = Min((x1 + tileSize - 1) >> tileBits, *Pointer<Int>(data + OFFSET(DrawData,coarseDepthTilesX)));
+
+			For(Int tileX = x0 >> tileBits, tileX < tileX1, tileX++)
+			{
+				Float4 zFar;
+
+				for(int row = 0; row < tileSize; row += 2)
+				{
+					Float4 z[4];
+
+					if(!state.quadLayoutDepthBuffer)
+					{
+						Pointer<Byte> buffer = tileRow + row * pitch + tileX * (tileSize * sizeof(float));
+
+						z[0] = *Pointer<Float4>(buffer);
+						z[1] = *Pointer<Float4>(buffer + 16);
+						z[2] = *Pointer<Float4>(buffer + pitch);
+						z[3] = *Pointer<Float4>(buffer + pitch + 16);
+					}
+					else
+					{
+						Pointer<Byte> buffer = tileRow + row * pitch + tileX * (2 * tileSize * sizeof(float));
+
+						z[0] = *Pointer<Float4>(buffer, 16);
+						z[1] = *Pointer<Float4>(buffer + 16, 16);
+						z[2] = *Pointer<Float4>(buffer + 32, 16);
+						z[3] = *Pointer<Float4>(buffer + 48, 16);
+					}
+
+					for(int i = 0; i < 4; i++)
+					{
+						if(row == 0 && i == 0)
+						{
+							zFar = z[0];
+						}
+						else if(!complementaryDepthBuffer)
+						{
+							zFar = Max(zFar, z[i]);
+						}
+						else
+						{
+							zFar = Min(zFar, z[i]);
+						}
+					}
+				}
+
+				Pointer<Float> bound = Pointer<Float>(coarseRow + tileX * sizeof(float));
+
+				if(!complementaryDepthBuffer)
+				{
+					zFar = Max(zFar, zFar.zwxy);
+					zFar = Max(zFar, zFar.yxwz);
+					*bound = Min(*bound, Float(zFar.x));
+				}
+				else
+				{
+					zFar = Min(zFar, zFar.zwxy);
+					zFar = Min(zFar, zFar.yxwz);
+					*bound = Max(*bound, Float(zFar.x));
+				}
+			}
+		}
+	}
+
+	void QuadRasterizer::rasterizeSpan(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x0, Int &x1, Int &y)
+	{
+		For(Int x = x0, x < x1, x += 2)
+		{
+			Short4 xxxx = Short4(x);
+			Int cMask[4];
+
+			for(unsigned int q = 0; q < state.multiSample; q++)
 			{
-				sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
+				cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
 			}
 
-			y += 2 * clusterCount;
+			quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
 		}
-		Until(y >= yMax)
 	}
 
 	Float4 QuadRasterizer::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp)
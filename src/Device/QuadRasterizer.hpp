@@ -54,7 +54,39 @@ namespace sw
 		const PixelShader *const shader;
 
 	private:
+		enum
+		{
+			TILE_SIZE_BITS = 6,   // Tile rasterization mode uses 64x64 pixel tiles
+			TILE_SIZE = 1 << TILE_SIZE_BITS
+		};
+
+		// Steps one side of a primitive's outline down the scanlines
+		struct EdgeWalker
+		{
+			Int y;    // Scanline of x
+			Int y2;   // End of the current edge
+			Int x;
+			Int d;
+			Int Q;
+			Int R;
+			Int D;
+		};
+
 		void rasterize(Int &yMin, Int &yMax);
+		void startEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right);
+		void nextEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right);
+		Int walkEdge(EdgeWalker &walker, Pointer<Byte> &sample, bool right, Int y);
+		void skipOccludedQuads(Pointer<Byte> &zBuffer, Int &x0, Int &x1, Int &y);
+		void skipOccludedTiles(Int &x0, Int &x1, Int &y);
+		void tightenCoarseDepth(Pointer<Byte> &zBuffer, Int &x0, Int &x1, Int &y, Int &yMax);
+		void rasterizeSpan(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x0, Int &x1, Int &y);
+		void skipRows(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int &rows);
+
+		int clusterCount;
+
+		// Tile columns covered by the primitive's bounding box, in tile rasterization mode
+		Int tileColumn;
+		Int tileColumns;
 	};
 }
 
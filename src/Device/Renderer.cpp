@@ -24,6 +24,7 @@
 #include "Pipeline/Constants.hpp"
 #include "System/MutexLock.hpp"
 #include "System/CPUID.hpp"
+#include "Reactor/CPUID.hpp"
 #include "System/Memory.hpp"
 #include "System/Resource.hpp"
 #include "System/Half.hpp"
@@ -55,15 +56,16 @@ namespace sw
 	extern bool exactColorRounding;
 	extern TransparencyAntialiasing transparencyAntialiasing;
 	extern bool forceClearRegisters;
+	extern bool tileRasterization;
+	extern bool coarseDepthTest;
+	extern bool guardBandClipping;
 
 	extern bool precacheVertex;
 	extern bool precacheSetup;
 	extern bool precachePixel;
+	extern bool precacheBlit;
 
 	static const int batchSize = 128;
-	AtomicInt threadCount(1);
-	AtomicInt Renderer::unitCount(1);
-	AtomicInt Renderer::clusterCount(1);
 
 	TranscendentalPrecision logPrecision = ACCURATE;
 	TranscendentalPrecision expPrecision = ACCURATE;
@@ -130,17 +132,27 @@ namespace sw
 		updateClipPlanes = true;
 
 		#if PERF_HUD
-			resetTimers();
+			vertexTime = nullptr;
+			setupTime = nullptr;
+			pixelTime = nullptr;
 		#endif
 
-		for(int i = 0; i < 16; i++)
-		{
-			vertexTask[i] = nullptr;
+		// Allocated by initializeThreads() once the thread, unit and cluster counts are known
+		worker = nullptr;
+		resume = nullptr;
+		suspend = nullptr;
+		task = nullptr;
+		taskQueue = nullptr;
+		vertexTask = nullptr;
 
-			worker[i] = nullptr;
-			resume[i] = nullptr;
-			suspend[i] = nullptr;
-		}
+		threadCount = 1;
+		unitCount = 1;
+		clusterCount = 1;
+
+		triangleBatch = nullptr;
+		primitiveBatch = nullptr;
+		primitiveProgress = nullptr;
+		pixelProgress = nullptr;
 
 		threadsAwake = 0;
 		resumeApp = new Event();
@@ -148,31 +160,12 @@ namespace sw
 		currentDraw = 0;
 		nextDraw = 0;
 
-		qHead = 0;
-		qSize = 0;
-
-		for(int i = 0; i < 16; i++)
-		{
-			triangleBatch[i] = nullptr;
-			primitiveBatch[i] = nullptr;
-		}
-
 		for(int draw = 0; draw < DRAW_COUNT; draw++)
 		{
 			drawCall[draw] = new DrawCall();
 			drawList[draw] = drawCall[draw];
 		}
 
-		for(int unit = 0; unit < 16; unit++)
-		{
-			primitiveProgress[unit].init();
-		}
-
-		for(int cluster = 0; cluster < 16; cluster++)
-		{
-			pixelProgress[cluster].init();
-		}
-
 		clipFlags = 0;
 
 		swiftConfig = new SwiftConfig(disableServer);
@@ -214,7 +207,7 @@ namespace sw
 		sw::deallocate(mem);
 	}
 
-	void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update)
+	void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, bool update)
 	{
 		#ifndef NDEBUG
 			if(count < minPrimitives || count > maxPrimitives)
@@ -223,6 +216,23 @@ namespace sw
 			}
 		#endif
 
+		if(count == 0 || instanceCount == 0)
+		{
+			return;
+		}
+
+		// The primitives of all instances are numbered consecutively, so split
+		// draws which would overflow the primitive counters
+		const unsigned int maxInstances = max(0x3FFFFFFFu / count, 1u);
+
+		while(instanceCount > maxInstances)
+		{
+			draw(drawType, indexOffset, count, maxInstances, update);
+
+			context->instanceID += maxInstances;
+			instanceCount -= maxInstances;
+		}
+
 		context->drawType = drawType;
 
 		updateConfiguration();
@@ -243,12 +253,19 @@ namespace sw
 		{
 			vertexState = VertexProcessor::update(drawType);
 			setupState = SetupProcessor::update();
-			pixelState = PixelProcessor::update();
+			pixelState = PixelProcessor::update(clusterCount);
 
 			vertexRoutine = VertexProcessor::routine(vertexState);
 			setupRoutine = SetupProcessor::routine(setupState);
+			cullRoutine = SetupProcessor::cullRoutine(setupState);
 			pixelRoutine = PixelProcessor::routine(pixelState);
 		}
+		else
+		{
+			// Unoptimized routines become hot after a number of draws, not state changes
+			vertexRoutine = VertexProcessor::reuse(vertexState, vertexRoutine);
+			pixelRoutine = PixelProcessor::reuse(pixelState, pixelRoutine);
+		}
 
 		int batch = batchSize / ms;
 
@@ -307,16 +324,22 @@ namespace sw
 
 		draw->drawType = drawType;
 		draw->batchSize = batch;
+		draw->deduplicateIndices = indexDeduplication && (drawType & DRAW_INDEXED16) && !vertexState.transformFeedbackEnabled;
+		draw->vertexCacheLookups = 0;
+		draw->vertexCacheMisses = 0;
 
 		vertexRoutine->bind();
 		setupRoutine->bind();
+		cullRoutine->bind();
 		pixelRoutine->bind();
 
 		draw->vertexRoutine = vertexRoutine;
 		draw->setupRoutine = setupRoutine;
+		draw->cullRoutine = cullRoutine;
 		draw->pixelRoutine = pixelRoutine;
 		draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
 		draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
+		draw->cullPointer = (SetupProcessor::CullRoutinePointer)cullRoutine->getEntry();
 		draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
 		draw->setupPrimitives = setupPrimitives;
 		draw->setupState = setupState;
@@ -415,11 +438,6 @@ namespace sw
 			draw->vsDirtyConstB = 0;
 		}
 
-		if(context->vertexShader->isInstanceIdDeclared())
-		{
-			data->instanceID = context->instanceID;
-		}
-
 		VertexProcessor::lockUniformBuffers(data->vs.u, draw->vUniformBuffers);
 		VertexProcessor::lockTransformFeedbackBuffers(data->vs.t, data->vs.reg, data->vs.row, data->vs.col, data->vs.str, draw->transformFeedbackBuffers);
 
@@ -545,6 +563,28 @@ namespace sw
 				data->depthBuffer = (float*)context->depthBuffer->lockInternal(0, 0, layer, LOCK_READWRITE, MANAGED);
 				data->depthPitchB = context->depthBuffer->getInternalPitchB();
 				data->depthSliceB = context->depthBuffer->getInternalSliceB();
+
+				// Coarse depth holds the farthest depth per tile, which depth writes only
+				// keep conservative when they move values closer to the viewer.
+				if(context->depthWriteActive() &&
+				   context->depthCompareMode != VK_COMPARE_OP_LESS &&
+				   context->depthCompareMode != VK_COMPARE_OP_LESS_OR_EQUAL &&
+				   context->depthCompareMode != VK_COMPARE_OP_NEVER)
+				{
+					context->depthBuffer->invalidateCoarseDepth();
+				}
+
+				data->coarseDepth = context->depthBuffer->getCoarseDepth();
+				data->coarseDepthPitch = data->coarseDepth ? context->depthBuffer->getCoarseDepthPitch() : 0;
+				data->coarseDepthTilesX = context->depthBuffer->getWidth() >> Surface::COARSE_DEPTH_TILE_BITS;
+				data->coarseDepthTilesY = context->depthBuffer->getHeight() >> Surface::COARSE_DEPTH_TILE_BITS;
+			}
+			else
+			{
+				data->coarseDepth = nullptr;
+				data->coarseDepthPitch = 0;
+				data->coarseDepthTilesX = 0;
+				data->coarseDepthTilesY = 0;
 			}
 
 			if(draw->stencilBuffer)
@@ -562,12 +602,29 @@ namespace sw
 			data->scissorX1 = scissor.x1;
 			data->scissorY0 = scissor.y0;
 			data->scissorY1 = scissor.y1;
+
+			if(guardBandClipping && context->isDrawTriangle())
+			{
+				// Triangles are no longer clipped to the viewport, so fragments outside of
+				// it get discarded by the scissor instead. Pixel centers are at half-integers.
+				float x0 = viewport.x;
+				float x1 = viewport.x + viewport.width;
+				float y0 = min(viewport.y, viewport.y + viewport.height);
+				float y1 = max(viewport.y, viewport.y + viewport.height);
+
+				data->scissorX0 = max(data->scissorX0, (int)ceil(x0 - 0.5f));
+				data->scissorX1 = min(data->scissorX1, (int)ceil(x1 - 0.5f));
+				data->scissorY0 = max(data->scissorY0, (int)ceil(y0 - 0.5f));
+				data->scissorY1 = min(data->scissorY1, (int)ceil(y1 - 0.5f));
+			}
 		}
 
 		draw->primitive = 0;
-		draw->count = count;
+		draw->count = count * instanceCount;
+		draw->instancePrimitives = count;
+		draw->firstInstance = context->instanceID;
 
-		draw->references = (count + batch - 1) / batch;
+		draw->references = instanceCount * ((count + batch - 1) / batch);   // Batches don't cross instances
 
 		schedulerMutex.lock();
 		++nextDraw; // Atomic
@@ -645,8 +702,10 @@ namespace sw
 		}
 	}
 
-	void Renderer::findAvailableTasks()
+	int Renderer::findAvailableTasks(int threadIndex)
 	{
+		int queued = 0;   // Tasks are distributed round-robin, starting with this thread's own queue
+
 		// Find pixel tasks
 		for(int cluster = 0; cluster < clusterCount; cluster++)
 		{
@@ -660,7 +719,7 @@ namespace sw
 						{
 							if(pixelProgress[cluster].processedPrimitives == primitiveProgress[unit].firstPrimitive)   // Previous primitives have been rendered
 							{
-								Task &task = taskQueue[qHead];
+								Task task;
 								task.type = Task::PIXELS;
 								task.primitiveUnit = unit;
 								task.pixelCluster = cluster;
@@ -668,8 +727,8 @@ namespace sw
 								pixelProgress[cluster].executing = true;
 
 								// Commit to the task queue
-								qHead = (qHead + 1) & TASK_COUNT_BITS;
-								qSize++;
+								taskQueue[(threadIndex + queued) % threadCount].push(task);
+								queued++;
 
 								break;
 							}
@@ -682,7 +741,7 @@ namespace sw
 		// Find primitive tasks
 		if(currentDraw == nextDraw)
 		{
-			return;   // No more primitives to process
+			return queued;   // No more primitives to process
 		}
 
 		for(int unit = 0; unit < unitCount; unit++)
@@ -698,7 +757,7 @@ namespace sw
 
 				if(currentDraw == nextDraw)
 				{
-					return;   // No more primitives to process
+					return queued;   // No more primitives to process
 				}
 
 				draw = drawList[currentDraw & DRAW_COUNT_BITS];
@@ -707,47 +766,96 @@ namespace sw
 			if(!primitiveProgress[unit].references)   // Task not already being executed and not still in use by a pixel unit
 			{
 				primitive = draw->primitive;
-				count = draw->count;
 				int batch = draw->batchSize;
 
+				// Batches end at the last primitive of their instance
+				int instanceEnd = (primitive / draw->instancePrimitives + 1) * draw->instancePrimitives;
+				int primitiveCount = min(instanceEnd - primitive, batch);
+
 				primitiveProgress[unit].drawCall = currentDraw;
 				primitiveProgress[unit].firstPrimitive = primitive;
-				primitiveProgress[unit].primitiveCount = count - primitive >= batch ? batch : count - primitive;
+				primitiveProgress[unit].primitiveCount = primitiveCount;
 
-				draw->primitive += batch;
+				draw->primitive += primitiveCount;
 
-				Task &task = taskQueue[qHead];
+				Task task;
 				task.type = Task::PRIMITIVES;
 				task.primitiveUnit = unit;
+				task.pixelCluster = 0;
 
 				primitiveProgress[unit].references = -1;
 
 				// Commit to the task queue
-				qHead = (qHead + 1) & TASK_COUNT_BITS;
-				qSize++;
+				taskQueue[(threadIndex + queued) % threadCount].push(task);
+				queued++;
 			}
 		}
+
+		return queued;
 	}
 
-	void Renderer::scheduleTask(int threadIndex)
+	bool Renderer::fetchTask(int threadIndex)
 	{
-		schedulerMutex.lock();
+		// Take from our own queue first, then steal from the other threads
+		for(int i = 0; i < threadCount; i++)
+		{
+			Task fetched;
 
-		int curThreadsAwake = threadsAwake;
+			if(taskQueue[(threadIndex + i) % threadCount].pop(fetched))
+			{
+				// This is called without the scheduler lock, while its holder reads the task
+				// types to find suspended threads. Storing the type last, with release ordering,
+				// publishes the complete task. Awake threads never change their type to or from
+				// SUSPEND here, only while holding the lock.
+				Task &current = task[threadIndex];
+				current.primitiveUnit = fetched.primitiveUnit;
+				current.pixelCluster = fetched.pixelCluster;
+				current.type = fetched.type;
 
-		if((int)qSize < threadCount - curThreadsAwake + 1)
-		{
-			findAvailableTasks();
+				return true;
+			}
 		}
 
-		if(qSize != 0)
+		return false;
+	}
+
+	void Renderer::scheduleTask(int threadIndex)
+	{
+		while(!fetchTask(threadIndex))
 		{
-			task[threadIndex] = taskQueue[(qHead - qSize) & TASK_COUNT_BITS];
-			qSize--;
+			// Only one thread at a time looks for new tasks. The others keep trying
+			// to steal the tasks it finds instead of blocking on the lock.
+			if(!schedulerMutex.attemptLock())
+			{
+				Thread::yield();
+				continue;
+			}
+
+			// Tasks can only be pushed while holding the lock, so if all queues are
+			// still empty now we can safely decide to suspend this thread.
+			if(fetchTask(threadIndex))
+			{
+				schedulerMutex.unlock();
+				return;
+			}
+
+			int queued = findAvailableTasks(threadIndex);
+
+			if(queued == 0)
+			{
+				task[threadIndex].type = Task::SUSPEND;
+
+				--threadsAwake; // Atomic
+
+				schedulerMutex.unlock();
+				return;
+			}
+
+			int curThreadsAwake = threadsAwake;
 
 			if(curThreadsAwake != threadCount)
 			{
-				int wakeup = qSize - curThreadsAwake + 1;
+				int wakeup = queued - curThreadsAwake;
 
 				for(int i = 0; i < threadCount && wakeup > 0; i++)
 				{
@@ -762,15 +870,9 @@ namespace sw
 					}
 				}
 			}
-		}
-		else
-		{
-			task[threadIndex].type = Task::SUSPEND;
 
-			--threadsAwake; // Atomic
+			schedulerMutex.unlock();
 		}
-
-		schedulerMutex.unlock();
 	}
 
 	void Renderer::executeTask(int threadIndex)
@@ -845,6 +947,63 @@ namespace sw
 		}
 	}
 
+	Renderer::TaskQueue::TaskQueue() : head(0), tail(0), slot(nullptr), sizeMask(0)
+	{
+	}
+
+	Renderer::TaskQueue::~TaskQueue()
+	{
+		delete[] slot;
+	}
+
+	void Renderer::TaskQueue::init(int capacity)
+	{
+		delete[] slot;
+
+		int size = ceilPow2(capacity);
+		slot = new AtomicInt[size];
+		sizeMask = size - 1;
+
+		head = 0;
+		tail = 0;
+	}
+
+	void Renderer::TaskQueue::push(const Task &task)
+	{
+		int t = tail;
+
+		// Queues can hold one task per unit and cluster, which is all that can be pending
+		ASSERT(t - head <= sizeMask);
+
+		// Only pushed while holding the scheduler lock, so there's a single producer
+		slot[t & sizeMask] = task.type | (task.primitiveUnit << 2) | (task.pixelCluster << 16);
+		tail = t + 1;
+	}
+
+	bool Renderer::TaskQueue::pop(Task &task)
+	{
+		while(true)
+		{
+			int h = head;
+
+			if(h == tail)
+			{
+				return false;   // Empty
+			}
+
+			int encoded = slot[h & sizeMask];
+
+			if(head.compareExchange(h, h + 1))
+			{
+				task.type = encoded & 0x3;
+				task.primitiveUnit = (encoded >> 2) & 0x3FFF;
+				task.pixelCluster = (encoded >> 16) & 0x7FFF;
+
+				return true;
+			}
+		}
+	}
+
 	void Renderer::synchronize()
 	{
 		sync->lock(sw::PUBLIC);
@@ -888,6 +1047,8 @@ namespace sw
 					}
 				#endif
 
+				recordVertexCacheStatistics(draw.vertexCacheLookups, draw.vertexCacheMisses);
+
 				if(draw.queries)
 				{
 					for(auto &query : *(draw.queries))
@@ -975,6 +1136,7 @@ namespace sw
 
 				draw.vertexRoutine->unbind();
 				draw.setupRoutine->unbind();
+				draw.cullRoutine->unbind();
 				draw.pixelRoutine->unbind();
 
 				sync->unlock();
@@ -998,12 +1160,19 @@ namespace sw
 		const void *indices = data->indices;
 		VertexProcessor::RoutinePointer vertexRoutine = draw->vertexPointer;
 
-		if(task->vertexCache.drawCall != primitiveDrawCall)
+		unsigned int instance = start / draw->instancePrimitives;
+		int instanceID = draw->firstInstance + instance;
+		start -= instance * draw->instancePrimitives;
+
+		// Cached vertices can depend on the instance
+		if(task->vertexCache.drawCall != primitiveDrawCall || task->instanceID != instanceID)
 		{
 			task->vertexCache.clear();
 			task->vertexCache.drawCall = primitiveDrawCall;
 		}
 
+		task->instanceID = instanceID;
+
 		unsigned int batch[128][3];   // FIXME: Adjust to dynamic batch size
 
 		switch(draw->drawType)
@@ -1279,9 +1448,81 @@ namespace sw
 			return;
 		}
 
+		unsigned int vertexCount = triangleCount * 3;
+		unsigned short source[sizeof(batch) / sizeof(unsigned int)];
+		int duplicates = draw->deduplicateIndices ? deduplicateIndices(&batch[0][0], vertexCount, source) : 0;
+
 		task->primitiveStart = start;
-		task->vertexCount = triangleCount * 3;
+		task->vertexCount = vertexCount;
 		vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+
+		if(duplicates > 0)
+		{
+			Vertex *vertex = &triangle->v0;
+			const unsigned int *index = &batch[0][0];
+
+			for(unsigned int i = 0; i < vertexCount; i++)
+			{
+				if(index[i] == VertexCache::SKIP_INDEX)
+				{
+					vertex[i] = vertex[source[i]];
+				}
+			}
+		}
+
+		draw->vertexCacheLookups += vertexCount;
+		draw->vertexCacheMisses += task->vertexCache.misses;
+	}
+
+	// Replaces indices which occur earlier in the batch with SKIP_INDEX, and stores
+	// the position of their first occurrence. Returns the number of replaced indices.
+	int Renderer::deduplicateIndices(unsigned int *indices, int count, unsigned short *source)
+	{
+		enum { TABLE_SIZE = 1024 };   // Keeps the table less than half full for batches of 128 triangles
+		ASSERT(count <= TABLE_SIZE / 2);
+
+		short table[TABLE_SIZE];
+		memset(table, 0xFF, sizeof(table));
+		int duplicates = 0;
+
+		for(int i = 0; i < count; i++)
+		{
+			unsigned int index = indices[i];
+
+			if(index == VertexCache::SKIP_INDEX)
+			{
+				// Can't be told apart from a replaced index, so undo the replacements
+				for(int j = 0; j < i; j++)
+				{
+					if(indices[j] == VertexCache::SKIP_INDEX)
+					{
+						indices[j] = indices[source[j]];
+					}
+				}
+
+				return 0;
+			}
+
+			unsigned int slot = (index * 0x9E3779B1u) >> 22;
+
+			while(table[slot] >= 0 && indices[table[slot]] != index)
+			{
+				slot = (slot + 1) & (TABLE_SIZE - 1);
+			}
+
+			if(table[slot] >= 0)
+			{
+				source[i] = table[slot];
+				indices[i] = VertexCache::SKIP_INDEX;
+				duplicates++;
+			}
+			else
+			{
+				table[slot] = (short)i;
+			}
+		}
+
+		return duplicates;
 	}
 
 	int Renderer::setupTriangles(int unit, int count)
@@ -1298,31 +1539,32 @@ namespace sw
 		const DrawData *data = draw.data;
 		int visible = 0;
 
-		for(int i = 0; i < count; i++, triangle++)
+		// Trivially rejected triangles are removed in bulk, before clipping and setup
+		int index[batchSize];
+		int candidates = draw.cullPointer(triangle, count, draw.clipFlags, index, data);
+
+		for(int i = 0; i < candidates; i++)
 		{
-			Vertex &v0 = triangle->v0;
-			Vertex &v1 = triangle->v1;
-			Vertex &v2 = triangle->v2;
+			Vertex &v0 = triangle[index[i]].v0;
+			Vertex &v1 = triangle[index[i]].v1;
+			Vertex &v2 = triangle[index[i]].v2;
 
-			if((v0.clipFlags & v1.clipFlags & v2.clipFlags) == Clipper::CLIP_FINITE)
-			{
-				Polygon polygon(&v0.v[pos], &v1.v[pos], &v2.v[pos]);
+			Polygon polygon(&v0.v[pos], &v1.v[pos], &v2.v[pos]);
 
-				int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags | draw.clipFlags;
+			int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags | draw.clipFlags;
 
-				if(clipFlagsOr != Clipper::CLIP_FINITE)
+			if(clipFlagsOr != Clipper::CLIP_FINITE && !(guardBandClipping && Clipper::insideGuardBand(v0, v1, v2, clipFlagsOr)))
+			{
+				if(!clipper->clip(polygon, clipFlagsOr, draw))
 				{
-					if(!clipper->clip(polygon, clipFlagsOr, draw))
-					{
-						continue;
-					}
+					continue;
 				}
+			}
 
-				if(setupRoutine(primitive, triangle, &polygon, data))
-				{
-					primitive += ms;
-					visible++;
-				}
+			if(setupRoutine(primitive, &triangle[index[i]], &polygon, data))
+			{
+				primitive += ms;
+				visible++;
 			}
 		}
 
@@ -1655,21 +1897,50 @@ namespace sw
 
 	void Renderer::initializeThreads()
 	{
-		unitCount = ceilPow2(threadCount);
-		clusterCount = ceilPow2(threadCount);
+		triangleBatch = new Triangle*[unitCount];
+		primitiveBatch = new Primitive*[unitCount];
+		primitiveProgress = new PrimitiveProgress[unitCount];
+
+		for(int unit = 0; unit < unitCount; unit++)
+		{
+			triangleBatch[unit] = (Triangle*)allocate(batchSize * sizeof(Triangle));
+			primitiveBatch[unit] = (Primitive*)allocate(batchSize * sizeof(Primitive));
+			primitiveProgress[unit].init();
+		}
+
+		pixelProgress = new PixelProgress[clusterCount];
 
-		for(int i = 0; i < unitCount; i++)
+		for(int cluster = 0; cluster < clusterCount; cluster++)
 		{
-			triangleBatch[i] = (Triangle*)allocate(batchSize * sizeof(Triangle));
-			primitiveBatch[i] = (Primitive*)allocate(batchSize * sizeof(Primitive));
+			// All previous draw calls have completed when (re)initializing,
+			// so every cluster continues from the current draw call.
+			pixelProgress[cluster].init();
+			pixelProgress[cluster].drawCall = currentDraw;
 		}
 
+		worker = new Thread*[threadCount];
+		resume = new Event*[threadCount];
+		suspend = new Event*[threadCount];
+		task = new Task[threadCount];
+		taskQueue = new TaskQueue[threadCount];
+		vertexTask = new VertexTask*[threadCount];
+
+		#if PERF_HUD
+			vertexTime = new int64_t[threadCount];
+			setupTime = new int64_t[threadCount];
+			pixelTime = new int64_t[threadCount];
+
+			resetTimers();
+		#endif
+
 		for(int i = 0; i < threadCount; i++)
 		{
 			vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
-			vertexTask[i]->vertexCache.drawCall = -1;
+			vertexTask[i]->instanceID = 0;
+			vertexTask[i]->vertexCache.allocate(vertexCacheSize);
 
 			task[i].type = Task::SUSPEND;
+			taskQueue[i].init(unitCount + clusterCount);   // A queue may receive every pending task
 
 			resume[i] = new Event();
 			suspend[i] = new Event();
@@ -1693,34 +1964,61 @@ namespace sw
 			Thread::sleep(1);
 		}
 
+		if(!worker)
+		{
+			return;   // Threads haven't been started
+		}
+
 		for(int thread = 0; thread < threadCount; thread++)
 		{
-			if(worker[thread])
-			{
-				exitThreads = true;
-				resume[thread]->signal();
-				worker[thread]->join();
+			exitThreads = true;
+			resume[thread]->signal();
+			worker[thread]->join();
 
-				delete worker[thread];
-				worker[thread] = 0;
-				delete resume[thread];
-				resume[thread] = 0;
-				delete suspend[thread];
-				suspend[thread] = 0;
-			}
+			delete worker[thread];
+			delete resume[thread];
+			delete suspend[thread];
 
+			vertexTask[thread]->vertexCache.deallocate();
 			deallocate(vertexTask[thread]);
-			vertexTask[thread] = 0;
 		}
 
-		for(int i = 0; i < 16; i++)
+		for(int unit = 0; unit < unitCount; unit++)
 		{
-			deallocate(triangleBatch[i]);
-			triangleBatch[i] = 0;
+			deallocate(triangleBatch[unit]);
+			deallocate(primitiveBatch[unit]);
+		}
+
+		delete[] worker;
+		worker = nullptr;
+		delete[] resume;
+		resume = nullptr;
+		delete[] suspend;
+		suspend = nullptr;
+		delete[] task;
+		task = nullptr;
+		delete[] taskQueue;
+		taskQueue = nullptr;
+		delete[] vertexTask;
+		vertexTask = nullptr;
+
+		delete[] triangleBatch;
+		triangleBatch = nullptr;
+		delete[] primitiveBatch;
+		primitiveBatch = nullptr;
+		delete[] primitiveProgress;
+		primitiveProgress = nullptr;
+		delete[] pixelProgress;
+		pixelProgress = nullptr;
 
-			deallocate(primitiveBatch[i]);
-			primitiveBatch[i] = 0;
-		}
+		#if PERF_HUD
+			delete[] vertexTime;
+			vertexTime = nullptr;
+			delete[] setupTime;
+			setupTime = nullptr;
+			delete[] pixelTime;
+			pixelTime = nullptr;
+		#endif
 	}
 
 	void Renderer::loadConstants(const VertexShader *vertexShader)
@@ -2334,11 +2632,17 @@ namespace sw
 			precacheVertex = !newConfiguration && configuration.precache;
 			precacheSetup = !newConfiguration && configuration.precache;
 			precachePixel = !newConfiguration && configuration.precache;
+			precacheBlit = !newConfiguration && configuration.precache;
+			retainObjectCode = !newConfiguration && configuration.precache;
+			precacheDirectory = configuration.precacheDirectory;
 
 			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
 			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
 			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
 
+			vertexCacheSize = configuration.vertexCacheSize;
+			indexDeduplication = configuration.indexDeduplication;
+
 			switch(configuration.textureSampleQuality)
 			{
 			case 0:  Sampler::setFilterQuality(FILTER_POINT);       break;
@@ -2410,12 +2714,27 @@ namespace sw
 			default: threadCount = configuration.threadCount; break;
 			}
 
+			threadCount = max(threadCount, 1);
+
+			// Pixel clusters can outnumber the primitive units so fill-rate bound
+			// workloads keep all cores busy without the memory cost of extra units.
+			unitCount = min(ceilPow2(configuration.unitCount > 0 ? configuration.unitCount : threadCount), (int)MAX_UNIT_COUNT);
+			clusterCount = min(ceilPow2(configuration.clusterCount > 0 ? configuration.clusterCount : threadCount), (int)MAX_CLUSTER_COUNT);
+
+			CPUID::setEnableAVX512(configuration.enableAVX512);
+			CPUID::setEnableAVX2(configuration.enableAVX2);
+			CPUID::setEnableAVX(configuration.enableAVX);
 			CPUID::setEnableSSE4_1(configuration.enableSSE4_1);
 			CPUID::setEnableSSSE3(configuration.enableSSSE3);
 			CPUID::setEnableSSE3(configuration.enableSSE3);
 			CPUID::setEnableSSE2(configuration.enableSSE2);
 			CPUID::setEnableSSE(configuration.enableSSE);
 
+			// Reactor has its own copy, which selects the instructions the JIT may use
+			rr::CPUID::setEnableAVX512(CPUID::supportsAVX512());
+			rr::CPUID::setEnableAVX2(CPUID::supportsAVX2());
+			rr::CPUID::setEnableAVX(CPUID::supportsAVX());
+
 			for(int pass = 0; pass < 10; pass++)
 			{
 				optimization[pass] = configuration.optimization[pass];
@@ -2426,6 +2745,30 @@ namespace sw
 			postBlendSRGB = configuration.postBlendSRGB;
 			exactColorRounding = configuration.exactColorRounding;
 			forceClearRegisters = configuration.forceClearRegisters;
+			tileRasterization = configuration.tileRasterization;
+			coarseDepthTest = configuration.coarseDepthTest;
+			guardBandClipping = configuration.guardBandClipping;
+			asyncRoutineCompilation = configuration.asyncRoutineCompilation;
+			hotRoutineThreshold = configuration.hotRoutineThreshold;
+
+			// Precached routines are only valid for identical code generation settings
+			const int settings[] =
+			{
+				configuration.textureSampleQuality, configuration.mipmapQuality, perspectiveCorrection,
+				logPrecision, expPrecision, rcpPrecision, rsqPrecision, transparencyAntialiasing, clusterCount,
+				configuration.enableSSE, configuration.enableSSE2, configuration.enableSSE3, configuration.enableSSSE3, configuration.enableSSE4_1,
+				configuration.enableAVX, configuration.enableAVX2, configuration.enableAVX512,
+				optimization[0], optimization[1], optimization[2], optimization[3], optimization[4],
+				optimization[5], optimization[6], optimization[7], optimization[8], optimization[9],
+				complementaryDepthBuffer, postBlendSRGB, exactColorRounding, forceClearRegisters, tileRasterization, coarseDepthTest
+			};
+
+			precacheConfiguration = 0;
+
+			for(int setting : settings)
+			{
+				precacheConfiguration = (precacheConfiguration ^ (uint64_t)setting) * 0x100000001B3ull;
+			}
 
 		#ifndef NDEBUG
 			minPrimitives = configuration.minPrimitives;
@@ -2433,7 +2776,7 @@ namespace sw
 		#endif
 		}
 
-		if(!initialUpdate && !worker[0])
+		if(!initialUpdate && !worker)
 		{
 			initializeThreads();
 		}
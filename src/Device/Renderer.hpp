@@ -144,8 +144,6 @@ namespace sw
 		VS vs;
 		PS ps;
 
-		int instanceID;
-
 		float pointSizeMin;
 		float pointSizeMax;
 		float lineWidth;
@@ -153,10 +151,10 @@ namespace sw
 		PixelProcessor::Stencil stencil[2];   // clockwise, counterclockwise
 		PixelProcessor::Stencil stencilCCW;
 		PixelProcessor::Factor factor;
-		unsigned int occlusion[16];   // Number of pixels passing depth test
+		unsigned int occlusion[MAX_CLUSTER_COUNT];   // Number of pixels passing depth test
 
 		#if PERF_PROFILE
-			int64_t cycles[PERF_TIMERS][16];
+			int64_t cycles[PERF_TIMERS][MAX_CLUSTER_COUNT];
 		#endif
 
 		float4 Wx16;
@@ -177,6 +175,10 @@ namespace sw
 		float *depthBuffer;
 		int depthPitchB;
 		int depthSliceB;
+		float *coarseDepth;
+		int coarseDepthPitch;   // In tiles, 0 when coarse depth is unavailable
+		int coarseDepthTilesX;   // Tiles lying entirely inside the depth buffer, which draws can tighten
+		int coarseDepthTilesY;
 		unsigned char *stencilBuffer;
 		int stencilPitchB;
 		int stencilSliceB;
@@ -242,6 +244,26 @@ namespace sw
 			AtomicInt executing;
 		};
 
+		// Per-thread ring of pending tasks. Tasks are only pushed by the thread which
+		// holds the scheduler lock, while any thread can pop (steal) them lock-free.
+		class TaskQueue
+		{
+		public:
+			TaskQueue();
+			~TaskQueue();
+
+			void init(int capacity);   // Rounded up to a power of 2
+
+			void push(const Task &task);
+			bool pop(Task &task);
+
+		private:
+			AtomicInt head;   // Next task to be popped
+			AtomicInt tail;   // Next free slot
+			AtomicInt *slot;
+			int sizeMask;
+		};
+
 	public:
 		Renderer(Context *context, Conventions conventions, bool exactColorRounding);
 
@@ -250,7 +272,8 @@ namespace sw
 		void *operator new(size_t size);
 		void operator delete(void * mem);
 
-		void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update = true);
+		// Draws instanceCount instances of count primitives, starting at the instance set by setInstanceID()
+		void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount = 1, bool update = true);
 
 		void clear(void *value, VkFormat format, Surface *dest, const Rect &rect, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false, bool sRGBconversion = true);
@@ -331,18 +354,18 @@ namespace sw
 			void resetTimers();
 		#endif
 
-		static int getClusterCount() { return clusterCount; }
-
 	private:
 		static void threadFunction(void *parameters);
 		void threadLoop(int threadIndex);
 		void taskLoop(int threadIndex);
-		void findAvailableTasks();
+		int findAvailableTasks(int threadIndex);
 		void scheduleTask(int threadIndex);
+		bool fetchTask(int threadIndex);
 		void executeTask(int threadIndex);
 		void finishRendering(Task &pixelTask);
 
 		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+		static int deduplicateIndices(unsigned int *indices, int count, unsigned short *source);
 
 		int setupTriangles(int batch, int count);
 		int setupLines(int batch, int count);
@@ -367,8 +390,8 @@ namespace sw
 		Rect scissor;
 		int clipFlags;
 
-		Triangle *triangleBatch[16];
-		Primitive *primitiveBatch[16];
+		Triangle **triangleBatch;     // [unitCount]
+		Primitive **primitiveBatch;   // [unitCount]
 
 		// User-defined clipping planes
 		Plane userPlane[MAX_CLIP_PLANES];
@@ -377,14 +400,14 @@ namespace sw
 
 		AtomicInt exitThreads;
 		AtomicInt threadsAwake;
-		Thread *worker[16];
-		Event *resume[16];         // Events for resuming threads
-		Event *suspend[16];        // Events for suspending threads
+		Thread **worker;           // [threadCount]
+		Event **resume;            // Events for resuming threads
+		Event **suspend;           // Events for suspending threads
 		Event *resumeApp;          // Event for resuming the application thread
 
-		PrimitiveProgress primitiveProgress[16];
-		PixelProgress pixelProgress[16];
-		Task task[16];   // Current tasks for threads
+		PrimitiveProgress *primitiveProgress;   // [unitCount]
+		PixelProgress *pixelProgress;           // [clusterCount]
+		Task *task;                             // Current tasks for threads [threadCount], see fetchTask()
 
 		enum {
 			DRAW_COUNT = 16,   // Number of draw calls buffered (must be power of 2)
@@ -396,26 +419,24 @@ namespace sw
 		AtomicInt currentDraw;
 		AtomicInt nextDraw;
 
-		enum {
-			TASK_COUNT = 32,   // Size of the task queue (must be power of 2)
-			TASK_COUNT_BITS = TASK_COUNT - 1,
-		};
-		Task taskQueue[TASK_COUNT];
-		AtomicInt qHead;
-		AtomicInt qSize;
+		TaskQueue *taskQueue;   // Pending tasks, one queue per thread [threadCount]
 
-		static AtomicInt unitCount;
-		static AtomicInt clusterCount;
+		// Only changed while the threads are terminated, and sizes the arrays above
+		int threadCount;
+		int unitCount;
+		int clusterCount;
 
-		MutexLock schedulerMutex;
+		MutexLock schedulerMutex;   // Only held while looking for new tasks
 
 		#if PERF_HUD
-			int64_t vertexTime[16];
-			int64_t setupTime[16];
-			int64_t pixelTime[16];
+			int64_t *vertexTime;   // [threadCount]
+			int64_t *setupTime;
+			int64_t *pixelTime;
 		#endif
 
-		VertexTask *vertexTask[16];
+		VertexTask **vertexTask;   // [threadCount]
+		int vertexCacheSize;       // Vertices cached per thread, 0 sizes the cache by its footprint
+		bool indexDeduplication;   // Repeated indices within a batch are processed once
 
 		SwiftConfig *swiftConfig;
 
@@ -428,6 +449,7 @@ namespace sw
 
 		Routine *vertexRoutine;
 		Routine *setupRoutine;
+		Routine *cullRoutine;
 		Routine *pixelRoutine;
 	};
 
@@ -442,10 +464,12 @@ namespace sw
 
 		Routine *vertexRoutine;
 		Routine *setupRoutine;
+		Routine *cullRoutine;
 		Routine *pixelRoutine;
 
 		VertexProcessor::RoutinePointer vertexPointer;
 		SetupProcessor::RoutinePointer setupPointer;
+		SetupProcessor::CullRoutinePointer cullPointer;
 		PixelProcessor::RoutinePointer pixelPointer;
 
 		int (Renderer::*setupPrimitives)(int batch, int count);
@@ -472,9 +496,15 @@ namespace sw
 		std::list<Query*> *queries;
 
 		AtomicInt clipFlags;
+		bool deduplicateIndices;
+
+		AtomicInt vertexCacheLookups;
+		AtomicInt vertexCacheMisses;   // Lines of vertices processed
 
 		AtomicInt primitive;    // Current primitive to enter pipeline
-		AtomicInt count;        // Number of primitives to render
+		AtomicInt count;        // Number of primitives to render, for all instances
+		int instancePrimitives;   // Number of primitives per instance
+		int firstInstance;
 		AtomicInt references;   // Remaining references to this draw call, 0 when done drawing, -1 when resources unlocked and slot is free
 
 		DrawData *data;
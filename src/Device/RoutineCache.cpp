@@ -0,0 +1,344 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineCache.hpp"
+
+#include "Reactor/CPUID.hpp"
+#include "System/Hash.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <dlfcn.h>
+	#include <unistd.h>
+#endif
+
+namespace sw
+{
+	std::string precacheDirectory;
+	uint64_t precacheConfiguration = 0;
+	bool asyncRoutineCompilation = false;
+	int hotRoutineThreshold = 16;
+
+	namespace
+	{
+		MutexLock statisticsMutex;
+		RoutineCompilationStatistics statistics = {};
+
+		enum
+		{
+			PRECACHE_MAGIC = 0x43525753,   // "SWRC"
+			PRECACHE_VERSION = 2,
+			PRECACHE_SLOTS = 1024,   // Per cache, bounds the number of files on disk
+			PRECACHE_MAX_OBJECT = 16 * 1024 * 1024
+		};
+
+		struct PrecacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t build;
+			uint64_t configuration;
+			uint32_t cpuFeatures;
+			uint32_t stateSize;
+			uint64_t objectSize;
+			uint64_t checksum;   // Of the object, seeded with the state hash
+		};
+
+		// Identifies the binary this code is part of, so rebuilt libraries never
+		// pick up routines generated by a different version of the code.
+		uint64_t buildIdentifier()
+		{
+			static uint64_t identifier = 0;
+
+			if(identifier == 0)
+			{
+				const char build[] = __DATE__ " " __TIME__;
+				uint64_t hash = hash64(build, sizeof(build));
+				std::string path;
+
+				#if defined(_WIN32)
+					HMODULE module = nullptr;
+					char name[MAX_PATH] = {};
+					if(GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&buildIdentifier, &module) &&
+					   GetModuleFileNameA(module, name, MAX_PATH))
+					{
+						path = name;
+					}
+				#else
+					Dl_info info;
+					if(dladdr((void*)&buildIdentifier, &info) && info.dli_fname)
+					{
+						path = info.dli_fname;
+					}
+				#endif
+
+				struct stat status;
+				if(!path.empty() && stat(path.c_str(), &status) == 0)
+				{
+					int64_t size = status.st_size;
+					int64_t time = status.st_mtime;
+					hash = hash64(&size, sizeof(size), hash);
+					hash = hash64(&time, sizeof(time), hash);
+				}
+
+				identifier = hash | 1;
+			}
+
+			return identifier;
+		}
+
+		uint32_t cpuFeatures()
+		{
+			return (CPUID::supportsMMX()    ? 0x01 : 0) |
+			       (CPUID::supportsCMOV()   ? 0x02 : 0) |
+			       (CPUID::supportsSSE()    ? 0x04 : 0) |
+			       (CPUID::supportsSSE2()   ? 0x08 : 0) |
+			       (CPUID::supportsSSE3()   ? 0x10 : 0) |
+			       (CPUID::supportsSSSE3()  ? 0x20 : 0) |
+			       (CPUID::supportsSSE4_1() ? 0x40 : 0) |
+			       (CPUID::supportsAVX()    ? 0x80 : 0) |
+			       (CPUID::supportsAVX2()   ? 0x100 : 0) |
+			       (CPUID::supportsAVX512() ? 0x200 : 0);
+		}
+
+		std::string precachePath(const char *precache, uint64_t stateHash)
+		{
+			char name[64];
+			sprintf(name, "%s-%04X.bin", precache, (unsigned int)(stateHash % PRECACHE_SLOTS));
+
+			if(precacheDirectory.empty())
+			{
+				return name;
+			}
+
+			return precacheDirectory + "/" + name;
+		}
+	}
+
+	Routine *loadPrecachedRoutine(const char *precache, const void *state, size_t stateSize, uint64_t stateHash)
+	{
+		std::string path = precachePath(precache, stateHash);
+		FILE *file = fopen(path.c_str(), "rb");
+
+		if(!file)
+		{
+			return nullptr;
+		}
+
+		PrecacheHeader header;
+		std::vector<unsigned char> stored;
+		std::vector<unsigned char> object;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		             header.magic == PRECACHE_MAGIC &&
+		             header.version == PRECACHE_VERSION &&
+		             header.build == buildIdentifier() &&
+		             header.configuration == precacheConfiguration &&
+		             header.cpuFeatures == cpuFeatures() &&
+		             header.stateSize == stateSize &&
+		             header.objectSize > 0 && header.objectSize <= PRECACHE_MAX_OBJECT;
+
+		if(valid)
+		{
+			// Different states can share a slot, so compare the full state
+			stored.resize(stateSize);
+			object.resize((size_t)header.objectSize);
+
+			valid = fread(&stored[0], stateSize, 1, file) == 1 &&
+			        memcmp(&stored[0], state, stateSize) == 0 &&
+			        fread(&object[0], object.size(), 1, file) == 1 &&
+			        hash64(&object[0], object.size(), stateHash) == header.checksum;
+		}
+
+		fclose(file);
+
+		return valid ? Nucleus::loadRoutine(&object[0], object.size()) : nullptr;
+	}
+
+	void storePrecachedRoutine(const char *precache, const void *state, size_t stateSize, uint64_t stateHash, Routine *routine)
+	{
+		size_t objectSize = 0;
+		const void *object = routine->getObject(objectSize);
+
+		if(!object || objectSize > PRECACHE_MAX_OBJECT)
+		{
+			return;
+		}
+
+		PrecacheHeader header;
+		header.magic = PRECACHE_MAGIC;
+		header.version = PRECACHE_VERSION;
+		header.build = buildIdentifier();
+		header.configuration = precacheConfiguration;
+		header.cpuFeatures = cpuFeatures();
+		header.stateSize = (uint32_t)stateSize;
+		header.objectSize = objectSize;
+		header.checksum = hash64(object, objectSize, stateHash);
+
+		// Write to a unique temporary file and rename it into place, so concurrent
+		// processes never observe partially written entries.
+		std::string path = precachePath(precache, stateHash);
+		char suffix[64];
+		sprintf(suffix, ".%d.%p.tmp", (int)getpid(), (void*)routine);
+		std::string temporary = path + suffix;
+
+		FILE *file = fopen(temporary.c_str(), "wb");
+
+		if(!file)
+		{
+			return;
+		}
+
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		               fwrite(state, stateSize, 1, file) == 1 &&
+		               fwrite(object, objectSize, 1, file) == 1;
+
+		if(fclose(file) != 0 || !written)
+		{
+			remove(temporary.c_str());
+			return;
+		}
+
+		#if defined(_WIN32)
+			bool renamed = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+		#else
+			bool renamed = rename(temporary.c_str(), path.c_str()) == 0;
+		#endif
+
+		if(!renamed)
+		{
+			remove(temporary.c_str());
+		}
+	}
+
+	RoutineCompilationStatistics getRoutineCompilationStatistics()
+	{
+		statisticsMutex.lock();
+		RoutineCompilationStatistics current = statistics;
+		statisticsMutex.unlock();
+
+		return current;
+	}
+
+	void recordFallbackRoutine(double seconds)
+	{
+		statisticsMutex.lock();
+		statistics.fallbackRoutines++;
+		statistics.fallbackTime += seconds;
+		statisticsMutex.unlock();
+	}
+
+	void recordBackgroundRoutine(double seconds)
+	{
+		statisticsMutex.lock();
+		statistics.optimizedRoutines++;
+		statistics.backgroundTime += seconds;
+		statisticsMutex.unlock();
+	}
+
+	BackgroundCompiler::BackgroundCompiler() : pending(0), exit(false)
+	{
+		thread = new Thread(threadFunction, this);
+	}
+
+	BackgroundCompiler::~BackgroundCompiler()
+	{
+		mutex.lock();
+		exit = true;
+		mutex.unlock();
+
+		taskAvailable.signal();
+
+		thread->join();
+		delete thread;
+	}
+
+	void BackgroundCompiler::submit(const std::function<void()> &task)
+	{
+		mutex.lock();
+		tasks.push_back(task);
+		pending++;
+		mutex.unlock();
+
+		taskAvailable.signal();
+	}
+
+	void BackgroundCompiler::wait()
+	{
+		while(true)
+		{
+			mutex.lock();
+			bool finished = (pending == 0);
+			mutex.unlock();
+
+			if(finished)
+			{
+				return;
+			}
+
+			idle.wait();
+		}
+	}
+
+	void BackgroundCompiler::threadFunction(void *parameters)
+	{
+		static_cast<BackgroundCompiler*>(parameters)->run();
+	}
+
+	void BackgroundCompiler::run()
+	{
+		while(true)
+		{
+			mutex.lock();
+
+			if(tasks.empty())
+			{
+				bool done = exit;
+				mutex.unlock();
+
+				if(done)
+				{
+					return;
+				}
+
+				taskAvailable.wait();
+				continue;
+			}
+
+			std::function<void()> task = tasks.front();
+			tasks.pop_front();
+			mutex.unlock();
+
+			task();
+
+			mutex.lock();
+			bool finished = (--pending == 0);
+			mutex.unlock();
+
+			if(finished)
+			{
+				idle.signal();
+			}
+		}
+	}
+}
@@ -18,11 +18,67 @@
 #include "LRUCache.hpp"
 
 #include "Reactor/Reactor.hpp"
+#include "System/MutexLock.hpp"
+#include "System/Thread.hpp"
+#include "System/Timer.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace sw
 {
 	using namespace rr;
 
+	extern std::string precacheDirectory;   // Empty for the working directory
+	extern uint64_t precacheConfiguration;   // Hash of the settings which affect generated code
+	extern bool asyncRoutineCompilation;     // Optimized routines are generated in the background
+	extern int hotRoutineThreshold;          // Draws using an unoptimized routine before it gets optimized
+
+	// The state hash selects the file, but entries are matched against the full state
+	Routine *loadPrecachedRoutine(const char *precache, const void *state, size_t stateSize, uint64_t stateHash);
+	void storePrecachedRoutine(const char *precache, const void *state, size_t stateSize, uint64_t stateHash, Routine *routine);
+
+	struct RoutineCompilationStatistics
+	{
+		int fallbackRoutines;    // Unoptimized routines generated on first use
+		int optimizedRoutines;   // Of those, the ones which became hot and were optimized
+		double fallbackTime;     // Seconds spent generating them on the calling thread
+		double backgroundTime;   // Seconds spent generating the optimized routines in the background
+	};
+
+	// Stall time avoided is the background time minus the fallback time
+	RoutineCompilationStatistics getRoutineCompilationStatistics();
+	void recordFallbackRoutine(double seconds);
+	void recordBackgroundRoutine(double seconds);
+
+	// Runs tasks on a background thread, in submission order
+	class BackgroundCompiler
+	{
+	public:
+		BackgroundCompiler();
+		~BackgroundCompiler();   // Finishes all submitted tasks
+
+		void submit(const std::function<void()> &task);
+		void wait();   // Until all submitted tasks are finished
+
+	private:
+		static void threadFunction(void *parameters);
+		void run();
+
+		Thread *thread;
+		MutexLock mutex;
+		std::deque<std::function<void()>> tasks;
+		int pending;
+		bool exit;
+
+		Event taskAvailable;
+		Event idle;
+	};
+
 	template<class State>
 	class RoutineCache : public LRUCache<State, Routine>
 	{
@@ -30,21 +86,258 @@ namespace sw
 		RoutineCache(int n, const char *precache = 0);
 		~RoutineCache();
 
+		// Routines which depend on process-local state, like shader IDs, must not be persistent.
+		// Each query counts as a use. Unoptimized routines return null once they've been used
+		// hotRoutineThreshold times, so the caller invokes generate() again to have them optimized.
+		Routine *query(const State &state, bool persistent = true);
+		Routine *add(const State &state, Routine *routine, bool persistent = true);
+
+		// Counts a use of a previously queried routine without looking up its state. Returns true
+		// when the routine should be queried again, because it became hot or optimized routines
+		// are ready to replace it.
+		bool use(Routine *routine);
+
+		// Generates and adds the routine for a missing state. With asyncRoutineCompilation an
+		// unoptimized routine is returned, and replaced once it became hot and the optimized one
+		// has been generated in the background. Anything the generator references must stay valid
+		// until synchronize().
+		Routine *generate(const State &state, const std::function<Routine*(bool optimize)> &generator, bool persistent = true);
+
+		void synchronize();   // Waits for background generation to finish
+
 	private:
-		const char *precache;
-		#if defined(_WIN32)
-		HMODULE precacheDLL;
-		#endif
+		struct Generated
+		{
+			State state;
+			Routine *routine;
+		};
+
+		void addGenerated();
+		void optimize(const State &state, const std::function<Routine*(bool optimize)> &generator, const char *precache);
+		void releaseEvictedFallbacks();
+
+		const char *precache;   // File name prefix of the on-disk cache, or null
+
+		// Unoptimized routines which haven't become hot yet, with the number of times they were
+		// queried. They stay bound, so evicted routines can't be mistaken for new allocations.
+		std::unordered_map<Routine*, int> fallbacks;
+
+		BackgroundCompiler *compiler;   // Created on first use
+		MutexLock generatedMutex;
+		std::vector<Generated> generated;
+		std::atomic<bool> anyGenerated;
 	};
 
 	template<class State>
-	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache)
+	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache), compiler(nullptr), anyGenerated(false)
 	{
 	}
 
 	template<class State>
 	RoutineCache<State>::~RoutineCache()
 	{
+		delete compiler;
+
+		for(auto &entry : generated)
+		{
+			delete entry.routine;
+		}
+
+		for(auto &fallback : fallbacks)
+		{
+			fallback.first->unbind();
+		}
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::query(const State &state, bool persistent)
+	{
+		if(anyGenerated)
+		{
+			addGenerated();
+		}
+
+		Routine *routine = LRUCache<State, Routine>::query(state);
+
+		if(routine && !fallbacks.empty())
+		{
+			auto fallback = fallbacks.find(routine);
+
+			if(fallback != fallbacks.end() && ++fallback->second >= hotRoutineThreshold)
+			{
+				return nullptr;   // Hot, let the caller provide the generator
+			}
+		}
+
+		if(!routine && precache && persistent)
+		{
+			routine = loadPrecachedRoutine(precache, &state, sizeof(State), state.hash);
+
+			if(routine)
+			{
+				LRUCache<State, Routine>::add(state, routine);
+			}
+		}
+
+		return routine;
+	}
+
+	template<class State>
+	bool RoutineCache<State>::use(Routine *routine)
+	{
+		if(anyGenerated)
+		{
+			return true;
+		}
+
+		if(fallbacks.empty())
+		{
+			return false;
+		}
+
+		auto fallback = fallbacks.find(routine);
+
+		return fallback != fallbacks.end() && ++fallback->second >= hotRoutineThreshold;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::add(const State &state, Routine *routine, bool persistent)
+	{
+		if(precache && persistent)
+		{
+			storePrecachedRoutine(precache, &state, sizeof(State), state.hash, routine);
+		}
+
+		return LRUCache<State, Routine>::add(state, routine);
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::generate(const State &state, const std::function<Routine*(bool optimize)> &generator, bool persistent)
+	{
+		if(!asyncRoutineCompilation)
+		{
+			return add(state, generator(true), persistent);
+		}
+
+		const char *precache = persistent ? this->precache : nullptr;
+
+		// A hot unoptimized routine keeps being used until its replacement is ready
+		Routine *fallback = LRUCache<State, Routine>::query(state);
+
+		if(fallback)
+		{
+			auto hot = fallbacks.find(fallback);
+
+			if(hot != fallbacks.end())
+			{
+				fallbacks.erase(hot);
+				fallback->unbind();
+
+				optimize(state, generator, precache);
+			}
+
+			return fallback;
+		}
+
+		double startTime = Timer::seconds();
+		fallback = generator(false);
+		recordFallbackRoutine(Timer::seconds() - startTime);
+
+		// Unoptimized routines are never stored on disk
+		LRUCache<State, Routine>::add(state, fallback);
+
+		if(hotRoutineThreshold <= 0)
+		{
+			optimize(state, generator, precache);
+		}
+		else
+		{
+			if(fallbacks.size() >= (size_t)LRUCache<State, Routine>::getSize())
+			{
+				releaseEvictedFallbacks();
+			}
+
+			fallback->bind();
+			fallbacks[fallback] = 0;
+		}
+
+		return fallback;
+	}
+
+	template<class State>
+	void RoutineCache<State>::optimize(const State &state, const std::function<Routine*(bool optimize)> &generator, const char *precache)
+	{
+		if(!compiler)
+		{
+			compiler = new BackgroundCompiler();
+		}
+
+		compiler->submit([this, state, generator, precache]()
+		{
+			double startTime = Timer::seconds();
+			Routine *routine = generator(true);
+			recordBackgroundRoutine(Timer::seconds() - startTime);
+
+			if(precache)
+			{
+				storePrecachedRoutine(precache, &state, sizeof(State), state.hash, routine);
+			}
+
+			generatedMutex.lock();
+			generated.push_back({state, routine});
+			anyGenerated = true;
+			generatedMutex.unlock();
+		});
+	}
+
+	template<class State>
+	void RoutineCache<State>::releaseEvictedFallbacks()
+	{
+		std::unordered_map<Routine*, int> cached;
+
+		for(int i = 0; i < LRUCache<State, Routine>::getSize(); i++)
+		{
+			auto fallback = fallbacks.find(LRUCache<State, Routine>::getData(i));
+
+			if(fallback != fallbacks.end())
+			{
+				cached.insert(*fallback);
+				fallbacks.erase(fallback);
+			}
+		}
+
+		// The remaining routines were evicted while still cold, and are no longer needed
+		for(auto &fallback : fallbacks)
+		{
+			fallback.first->unbind();
+		}
+
+		fallbacks.swap(cached);
+	}
+
+	template<class State>
+	void RoutineCache<State>::synchronize()
+	{
+		if(compiler)
+		{
+			compiler->wait();
+		}
+	}
+
+	template<class State>
+	void RoutineCache<State>::addGenerated()
+	{
+		generatedMutex.lock();
+		std::vector<Generated> routines;
+		routines.swap(generated);
+		anyGenerated = false;
+		generatedMutex.unlock();
+
+		// Replaces the fallback routines, which get deleted once no draw uses them
+		for(auto &entry : routines)
+		{
+			LRUCache<State, Routine>::add(entry.state, entry.routine);
+		}
 	}
 }
 
@@ -18,8 +18,10 @@
 #include "Polygon.hpp"
 #include "Context.hpp"
 #include "Renderer.hpp"
+#include "Pipeline/CullRoutine.hpp"
 #include "Pipeline/SetupRoutine.hpp"
 #include "Pipeline/Constants.hpp"
+#include "System/Hash.hpp"
 #include "Vulkan/VkDebug.hpp"
 
 namespace sw
@@ -29,17 +31,9 @@ namespace sw
 
 	bool precacheSetup = false;
 
-	unsigned int SetupProcessor::States::computeHash()
+	uint64_t SetupProcessor::States::computeHash()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
-
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
-		{
-			hash ^= state[i];
-		}
-
-		return hash;
+		return hash64(this, sizeof(States));
 	}
 
 	SetupProcessor::State::State(int i)
@@ -60,6 +54,7 @@ namespace sw
 	SetupProcessor::SetupProcessor(Context *context) : context(context)
 	{
 		routineCache = nullptr;
+		cullRoutineCache = nullptr;
 		setRoutineCacheSize(1024);
 	}
 
@@ -67,6 +62,9 @@ namespace sw
 	{
 		delete routineCache;
 		routineCache = nullptr;
+
+		delete cullRoutineCache;
+		cullRoutineCache = nullptr;
 	}
 
 	SetupProcessor::State SetupProcessor::update() const
@@ -161,9 +159,37 @@ namespace sw
 		return routine;
 	}
 
+	Routine *SetupProcessor::cullRoutine(const State &state)
+	{
+		// Culling only depends on a few fields, so setup states share cull routines
+		State cullState;
+		cullState.isDrawTriangle = state.isDrawTriangle;
+		cullState.positionRegister = state.positionRegister;
+		cullState.cullMode = state.cullMode;
+		cullState.multiSample = state.multiSample;
+		cullState.hash = cullState.computeHash();
+
+		Routine *routine = cullRoutineCache->query(cullState);
+
+		if(!routine)
+		{
+			CullRoutine *generator = new CullRoutine(cullState);
+			generator->generate();
+			routine = generator->getRoutine();
+			delete generator;
+
+			cullRoutineCache->add(cullState, routine);
+		}
+
+		return routine;
+	}
+
 	void SetupProcessor::setRoutineCacheSize(int cacheSize)
 	{
 		delete routineCache;
 		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheSetup ? "sw-setup" : 0);
+
+		delete cullRoutineCache;
+		cullRoutineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheSetup ? "sw-cull" : 0);
 	}
 }
@@ -35,7 +35,7 @@ namespace sw
 	public:
 		struct States
 		{
-			unsigned int computeHash();
+			uint64_t computeHash();
 
 			bool isDrawPoint               : 1;
 			bool isDrawLine                : 1;
@@ -68,10 +68,11 @@ namespace sw
 
 			bool operator==(const State &states) const;
 
-			unsigned int hash;
+			uint64_t hash;
 		};
 
 		typedef bool (*RoutinePointer)(Primitive *primitive, const Triangle *triangle, const Polygon *polygon, const DrawData *draw);
+		typedef int (*CullRoutinePointer)(const Triangle *triangles, int count, int clipFlags, int *visible, const DrawData *draw);   // Returns the number of visible triangle indices
 
 		SetupProcessor(Context *context);
 
@@ -80,6 +81,7 @@ namespace sw
 	protected:
 		State update() const;
 		Routine *routine(const State &state);
+		Routine *cullRoutine(const State &state);
 
 		void setRoutineCacheSize(int cacheSize);
 
@@ -87,6 +89,7 @@ namespace sw
 		Context *const context;
 
 		RoutineCache<State> *routineCache;
+		RoutineCache<State> *cullRoutineCache;
 	};
 }
 
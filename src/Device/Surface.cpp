@@ -37,6 +37,7 @@ namespace sw
 {
 	extern bool quadLayoutEnabled;
 	extern bool complementaryDepthBuffer;
+	extern bool coarseDepthTest;
 	extern TranscendentalPrecision logPrecision;
 
 	void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
@@ -824,6 +825,10 @@ namespace sw
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
 
+		coarseDepth = nullptr;
+		coarseDepthPitch = 0;
+		coarseDepthValid = false;
+
 		dirtyContents = true;
 	}
 
@@ -880,6 +885,10 @@ namespace sw
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
 
+		coarseDepth = nullptr;
+		coarseDepthPitch = 0;
+		coarseDepthValid = false;
+
 		dirtyContents = true;
 	}
 
@@ -905,10 +914,12 @@ namespace sw
 		}
 
 		deallocate(stencil.buffer);
+		deallocate(coarseDepth);
 
 		external.buffer = nullptr;
 		internal.buffer = nullptr;
 		stencil.buffer = nullptr;
+		coarseDepth = nullptr;
 	}
 
 	void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
@@ -945,6 +956,7 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyContents = true;
+			coarseDepthValid = false;
 			break;
 		default:
 			ASSERT(false);
@@ -1021,6 +1033,12 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyContents = true;
+
+			// The renderer keeps coarse depth conservative for its own writes
+			if(client != MANAGED)
+			{
+				coarseDepthValid = false;
+			}
 			break;
 		default:
 			ASSERT(false);
@@ -2741,6 +2759,7 @@ namespace sw
 
 		const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
 		const Lock lock = entire ? LOCK_DISCARD : LOCK_WRITEONLY;
+		const bool coarseValid = coarseDepthValid;   // Locking for write invalidates it
 
 		int x1 = x0 + width;
 		int y1 = y0 + height;
@@ -2760,6 +2779,8 @@ namespace sw
 				target += internal.sliceP;
 			}
 
+			updateCoarseDepth(depth, x0, y0, x1, y1, coarseValid);
+
 			unlockInternal();
 		}
 		else   // Quad layout
@@ -2842,10 +2863,82 @@ namespace sw
 				buffer += internal.sliceP;
 			}
 
+			updateCoarseDepth(depth, x0, y0, x1, y1, coarseValid);
+
 			unlockInternal();
 		}
 	}
 
+	void Surface::updateCoarseDepth(float depth, int x0, int y0, int x1, int y1, bool valid)
+	{
+		const bool entire = x0 == 0 && y0 == 0 && x1 == internal.width && y1 == internal.height;
+
+		// Only single-sampled 2D depth buffers are tracked, and tiles can only
+		// be rebuilt from scratch when the whole surface gets cleared.
+		if(!coarseDepthTest || internal.samples != 1 || internal.depth != 1 || !(valid || entire))
+		{
+			coarseDepthValid = false;
+			return;
+		}
+
+		int tilesX = (internal.width + COARSE_DEPTH_TILE - 1) >> COARSE_DEPTH_TILE_BITS;
+		int tilesY = (internal.height + COARSE_DEPTH_TILE - 1) >> COARSE_DEPTH_TILE_BITS;
+
+		if(!coarseDepth)
+		{
+			coarseDepth = (float*)allocate(tilesX * tilesY * sizeof(float));
+			coarseDepthPitch = tilesX;
+		}
+
+		int tileX0 = x0 >> COARSE_DEPTH_TILE_BITS;
+		int tileY0 = y0 >> COARSE_DEPTH_TILE_BITS;
+		int tileX1 = (x1 + COARSE_DEPTH_TILE - 1) >> COARSE_DEPTH_TILE_BITS;
+		int tileY1 = (y1 + COARSE_DEPTH_TILE - 1) >> COARSE_DEPTH_TILE_BITS;
+
+		for(int tileY = tileY0; tileY < tileY1; tileY++)
+		{
+			int top = tileY << COARSE_DEPTH_TILE_BITS;
+			bool coverY = top >= y0 && min(top + COARSE_DEPTH_TILE, internal.height) <= y1;
+
+			for(int tileX = tileX0; tileX < tileX1; tileX++)
+			{
+				int left = tileX << COARSE_DEPTH_TILE_BITS;
+				bool covered = coverY && left >= x0 && min(left + COARSE_DEPTH_TILE, internal.width) <= x1;
+				float &tile = coarseDepth[tileY * coarseDepthPitch + tileX];
+
+				if(covered || entire)
+				{
+					tile = depth;
+				}
+				else if(complementaryDepthBuffer)   // Farthest is smallest
+				{
+					tile = min(tile, depth);
+				}
+				else
+				{
+					tile = max(tile, depth);
+				}
+			}
+		}
+
+		coarseDepthValid = true;
+	}
+
+	float *Surface::getCoarseDepth() const
+	{
+		return (coarseDepthTest && coarseDepthValid) ? coarseDepth : nullptr;
+	}
+
+	int Surface::getCoarseDepthPitch() const
+	{
+		return coarseDepthPitch;
+	}
+
+	void Surface::invalidateCoarseDepth()
+	{
+		coarseDepthValid = false;
+	}
+
 	void Surface::clearStencil(unsigned char s, unsigned char mask, int x0, int y0, int width, int height)
 	{
 		if(mask == 0 || width == 0 || height == 0)
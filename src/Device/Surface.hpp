@@ -186,6 +186,16 @@ namespace sw
 		bool hasDepth() const;
 		bool isRenderTarget() const;
 
+		enum
+		{
+			COARSE_DEPTH_TILE_BITS = 3,   // Coarse depth is tracked per 8x8 pixel tile
+			COARSE_DEPTH_TILE = 1 << COARSE_DEPTH_TILE_BITS
+		};
+
+		float *getCoarseDepth() const;   // Farthest depth per tile, or null when out of date
+		int getCoarseDepthPitch() const;   // In tiles
+		void invalidateCoarseDepth();
+
 		bool hasDirtyContents() const;
 		void markContentsClean();
 		inline bool isExternalDirty() const;
@@ -313,11 +323,16 @@ namespace sw
 		VkFormat selectInternalFormat(VkFormat format) const;
 
 		void resolve();
+		void updateCoarseDepth(float depth, int x0, int y0, int x1, int y1, bool valid);
 
 		Buffer external;
 		Buffer internal;
 		Buffer stencil;
 
+		float *coarseDepth;
+		int coarseDepthPitch;
+		bool coarseDepthValid;
+
 		const bool lockable;
 		const bool renderTarget;
 
@@ -335,9 +335,15 @@ namespace sw
 		html += "</select></td>\n";
 		html += "</tr>\n";
 		html += "<tr><td>Vertex cache size:</td><td><select name='vertexCacheSize' title='The number of processed vertices being cached for reuse. Lower numbers save memory but require more vertices to be reprocessed.'>\n";
-		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64 (default)</option>\n";
+		html += "<option value='0'"    + (config.vertexCacheSize == 0    ? selected : empty) + ">Automatic (default)</option>\n";
+		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64</option>\n";
+		html += "<option value='128'"  + (config.vertexCacheSize == 128  ? selected : empty) + ">128</option>\n";
+		html += "<option value='256'"  + (config.vertexCacheSize == 256  ? selected : empty) + ">256</option>\n";
+		html += "<option value='512'"  + (config.vertexCacheSize == 512  ? selected : empty) + ">512</option>\n";
+		html += "<option value='1024'" + (config.vertexCacheSize == 1024 ? selected : empty) + ">1024</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Index deduplication:</td><td><input name = 'indexDeduplication' type='checkbox'" + (config.indexDeduplication ? checked : empty) + " title='If checked repeated indices within a batch are processed once, regardless of vertex cache conflicts.'></td></tr>\n";
 		html += "</table>\n";
 		html += "<h2><em>Quality</em></h2>\n";
 		html += "<table>\n";
@@ -392,11 +398,25 @@ namespace sw
 		html += "<option value='15'" + (config.threadCount == 15 ? selected : empty) + ">15</option>\n";
 		html += "<option value='16'" + (config.threadCount == 16 ? selected : empty) + ">16</option>\n";
 		html += "</select></td></tr>\n";
+		html += "<tr><td>Tile rasterization:</td><td><input name = 'tileRasterization' type='checkbox'" + (config.tileRasterization ? checked : empty) + " title='If checked pixel clusters rasterize interleaved 64x64 pixel tiles instead of scanline pairs.'></td></tr>";
+		html += "<tr><td>Coarse depth test:</td><td><input name = 'coarseDepthTest' type='checkbox'" + (config.coarseDepthTest ? checked : empty) + " title='If checked depth buffers track the farthest depth per 8x8 pixel tile to reject occluded spans before shading.'></td></tr>";
+		html += "<tr><td>Guard-band clipping:</td><td><input name = 'guardBandClipping' type='checkbox'" + (config.guardBandClipping ? checked : empty) + " title='If checked triangles which only extend past the viewport edges are scissored instead of clipped.'></td></tr>";
+		html += "<tr><td>Asynchronous routine compilation:</td><td><input name = 'asyncRoutineCompilation' type='checkbox'" + (config.asyncRoutineCompilation ? checked : empty) + " title='If checked new routines are first generated without optimizations, and replaced by optimized ones generated in the background.'></td></tr>";
+		html += "<tr><td>Hot routine threshold:</td><td><select name='hotRoutineThreshold' title='The number of draws using an unoptimized routine before its optimized version is generated in the background, whether or not the state changed between them. Routines used less often stay unoptimized.'>\n";
+		html += "<option value='0'"   + (config.hotRoutineThreshold == 0   ? selected : empty) + ">0 (on first use)</option>\n";
+		html += "<option value='4'"   + (config.hotRoutineThreshold == 4   ? selected : empty) + ">4</option>\n";
+		html += "<option value='16'"  + (config.hotRoutineThreshold == 16  ? selected : empty) + ">16 (default)</option>\n";
+		html += "<option value='64'"  + (config.hotRoutineThreshold == 64  ? selected : empty) + ">64</option>\n";
+		html += "<option value='256'" + (config.hotRoutineThreshold == 256 ? selected : empty) + ">256</option>\n";
+		html += "</select></td></tr>\n";
 		html += "<tr><td>Enable SSE:</td><td><input name = 'enableSSE' type='checkbox'" + (config.enableSSE ? checked : empty) + " disabled='disabled' title='If checked enables the use of SSE instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE2:</td><td><input name = 'enableSSE2' type='checkbox'" + (config.enableSSE2 ? checked : empty) + " title='If checked enables the use of SSE2 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE3:</td><td><input name = 'enableSSE3' type='checkbox'" + (config.enableSSE3 ? checked : empty) + " title='If checked enables the use of SSE3 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSSE3:</td><td><input name = 'enableSSSE3' type='checkbox'" + (config.enableSSSE3 ? checked : empty) + " title='If checked enables the use of SSSE3 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE4.1:</td><td><input name = 'enableSSE4_1' type='checkbox'" + (config.enableSSE4_1 ? checked : empty) + " title='If checked enables the use of SSE4.1 instruction set extentions if supported by the CPU.'></td></tr>";
+		html += "<tr><td>Enable AVX:</td><td><input name = 'enableAVX' type='checkbox'" + (config.enableAVX ? checked : empty) + " title='If checked enables the use of AVX instruction set extentions if supported by the CPU and the operating system.'></td></tr>";
+		html += "<tr><td>Enable AVX2:</td><td><input name = 'enableAVX2' type='checkbox'" + (config.enableAVX2 ? checked : empty) + " title='If checked enables the use of AVX2 instruction set extentions if supported by the CPU and the operating system.'></td></tr>";
+		html += "<tr><td>Enable AVX-512:</td><td><input name = 'enableAVX512' type='checkbox'" + (config.enableAVX512 ? checked : empty) + " title='If checked enables the use of the AVX-512 F, VL, BW and DQ instruction set extentions if supported by the CPU and the operating system.'></td></tr>";
 		html += "</table>\n";
 		html += "<h2><em>Compiler optimizations</em></h2>\n";
 		html += "<table>\n";
@@ -431,7 +451,7 @@ namespace sw
 		html += "<option value='0'" + (config.frameBufferAPI == 0 ? selected : empty) + ">DirectDraw (default)</option>\n";
 		html += "<option value='1'" + (config.frameBufferAPI == 1 ? selected : empty) + ">GDI</option>\n";
 		html += "</select></td>\n";
-		html += "<tr><td>DLL precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored in a DLL for faster loading on application restart.'></td></tr>";
+		html += "<tr><td>Routine precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored on disk for faster loading on application restart.'></td></tr>";
 		html += "<tr><td>Shadow mapping extensions:</td><td><select name='shadowMapping' title='Features that may accelerate or improve the quality of shadow mapping.'>\n";
 		html += "<option value='0'" + (config.shadowMapping == 0 ? selected : empty) + ">None</option>\n";
 		html += "<option value='1'" + (config.shadowMapping == 1 ? selected : empty) + ">Fetch4</option>\n";
@@ -534,11 +554,19 @@ namespace sw
 	void SwiftConfig::parsePost(const char *post)
 	{
 		// Only enabled checkboxes appear in the POST
+		config.tileRasterization = false;
+		config.coarseDepthTest = false;
+		config.guardBandClipping = false;
+		config.indexDeduplication = false;
+		config.asyncRoutineCompilation = false;
 		config.enableSSE = true;
 		config.enableSSE2 = false;
 		config.enableSSE3 = false;
 		config.enableSSSE3 = false;
 		config.enableSSE4_1 = false;
+		config.enableAVX = false;
+		config.enableAVX2 = false;
+		config.enableAVX512 = false;
 		config.disableServer = false;
 		config.forceWindowed = false;
 		config.complementaryDepthBuffer = false;
@@ -610,6 +638,18 @@ namespace sw
 			{
 				config.threadCount = integer;
 			}
+			else if(sscanf(post, "unitCount=%d", &integer))
+			{
+				config.unitCount = integer;
+			}
+			else if(sscanf(post, "clusterCount=%d", &integer))
+			{
+				config.clusterCount = integer;
+			}
+			else if(sscanf(post, "hotRoutineThreshold=%d", &integer))
+			{
+				config.hotRoutineThreshold = integer;
+			}
 			else if(sscanf(post, "frameBufferAPI=%d", &integer))
 			{
 				config.frameBufferAPI = integer;
@@ -650,6 +690,27 @@ namespace sw
 					config.enableSSE4_1 = true;
 				}
 			}
+			else if(strstr(post, "enableAVX=on"))
+			{
+				if(config.enableSSE4_1)
+				{
+					config.enableAVX = true;
+				}
+			}
+			else if(strstr(post, "enableAVX2=on"))
+			{
+				if(config.enableAVX)
+				{
+					config.enableAVX2 = true;
+				}
+			}
+			else if(strstr(post, "enableAVX512=on"))
+			{
+				if(config.enableAVX2)
+				{
+					config.enableAVX512 = true;
+				}
+			}
 			else if(sscanf(post, "optimization%d=%d", &index, &integer))
 			{
 				config.optimization[index - 1] = (rr::Optimization)integer;
@@ -682,6 +743,26 @@ namespace sw
 			{
 				config.disable10BitMode = true;
 			}
+			else if(strstr(post, "tileRasterization=on"))
+			{
+				config.tileRasterization = true;
+			}
+			else if(strstr(post, "coarseDepthTest=on"))
+			{
+				config.coarseDepthTest = true;
+			}
+			else if(strstr(post, "guardBandClipping=on"))
+			{
+				config.guardBandClipping = true;
+			}
+			else if(strstr(post, "indexDeduplication=on"))
+			{
+				config.indexDeduplication = true;
+			}
+			else if(strstr(post, "asyncRoutineCompilation=on"))
+			{
+				config.asyncRoutineCompilation = true;
+			}
 			else if(strstr(post, "precache=on"))
 			{
 				config.precache = true;
@@ -724,18 +805,29 @@ namespace sw
 		config.vertexRoutineCacheSize = ini.getInteger("Caches", "VertexRoutineCacheSize", 1024);
 		config.pixelRoutineCacheSize = ini.getInteger("Caches", "PixelRoutineCacheSize", 1024);
 		config.setupRoutineCacheSize = ini.getInteger("Caches", "SetupRoutineCacheSize", 1024);
-		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 64);
+		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 0);
+		config.indexDeduplication = ini.getBoolean("Caches", "IndexDeduplication", false);
 		config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 		config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
 		config.perspectiveCorrection = ini.getBoolean("Quality", "PerspectiveCorrection", true);
 		config.transcendentalPrecision = ini.getInteger("Quality", "TranscendentalPrecision", 2);
 		config.transparencyAntialiasing = ini.getInteger("Quality", "TransparencyAntialiasing", 0);
 		config.threadCount = ini.getInteger("Processor", "ThreadCount", DEFAULT_THREAD_COUNT);
+		config.unitCount = ini.getInteger("Processor", "UnitCount", 0);
+		config.clusterCount = ini.getInteger("Processor", "ClusterCount", 0);
+		config.tileRasterization = ini.getBoolean("Processor", "TileRasterization", false);
+		config.coarseDepthTest = ini.getBoolean("Processor", "CoarseDepthTest", false);
+		config.guardBandClipping = ini.getBoolean("Processor", "GuardBandClipping", true);
+		config.asyncRoutineCompilation = ini.getBoolean("Processor", "AsyncRoutineCompilation", false);
+		config.hotRoutineThreshold = ini.getInteger("Processor", "HotRoutineThreshold", 16);
 		config.enableSSE = ini.getBoolean("Processor", "EnableSSE", true);
 		config.enableSSE2 = ini.getBoolean("Processor", "EnableSSE2", true);
 		config.enableSSE3 = ini.getBoolean("Processor", "EnableSSE3", true);
 		config.enableSSSE3 = ini.getBoolean("Processor", "EnableSSSE3", true);
 		config.enableSSE4_1 = ini.getBoolean("Processor", "EnableSSE4_1", true);
+		config.enableAVX = ini.getBoolean("Processor", "EnableAVX", true);
+		config.enableAVX2 = ini.getBoolean("Processor", "EnableAVX2", true);
+		config.enableAVX512 = ini.getBoolean("Processor", "EnableAVX512", true);
 
 		for(int pass = 0; pass < 10; pass++)
 		{
@@ -751,6 +843,7 @@ namespace sw
 		config.disable10BitMode = ini.getBoolean("Testing", "Disable10BitMode", false);
 		config.frameBufferAPI = ini.getInteger("Testing", "FrameBufferAPI", 0);
 		config.precache = ini.getBoolean("Testing", "Precache", false);
+		config.precacheDirectory = ini.getValue("Testing", "PrecacheDirectory", "");
 		config.shadowMapping = ini.getInteger("Testing", "ShadowMapping", 3);
 		config.forceClearRegisters = ini.getBoolean("Testing", "ForceClearRegisters", false);
 
@@ -783,17 +876,28 @@ namespace sw
 		ini.addValue("Caches", "PixelRoutineCacheSize", itoa(config.pixelRoutineCacheSize));
 		ini.addValue("Caches", "SetupRoutineCacheSize", itoa(config.setupRoutineCacheSize));
 		ini.addValue("Caches", "VertexCacheSize", itoa(config.vertexCacheSize));
+		ini.addValue("Caches", "IndexDeduplication", itoa(config.indexDeduplication));
 		ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 		ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
 		ini.addValue("Quality", "PerspectiveCorrection", itoa(config.perspectiveCorrection));
 		ini.addValue("Quality", "TranscendentalPrecision", itoa(config.transcendentalPrecision));
 		ini.addValue("Quality", "TransparencyAntialiasing", itoa(config.transparencyAntialiasing));
 		ini.addValue("Processor", "ThreadCount", itoa(config.threadCount));
+		ini.addValue("Processor", "UnitCount", itoa(config.unitCount));
+		ini.addValue("Processor", "ClusterCount", itoa(config.clusterCount));
+		ini.addValue("Processor", "TileRasterization", itoa(config.tileRasterization));
+		ini.addValue("Processor", "CoarseDepthTest", itoa(config.coarseDepthTest));
+		ini.addValue("Processor", "GuardBandClipping", itoa(config.guardBandClipping));
+		ini.addValue("Processor", "AsyncRoutineCompilation", itoa(config.asyncRoutineCompilation));
+		ini.addValue("Processor", "HotRoutineThreshold", itoa(config.hotRoutineThreshold));
 	//	ini.addValue("Processor", "EnableSSE", itoa(config.enableSSE));
 		ini.addValue("Processor", "EnableSSE2", itoa(config.enableSSE2));
 		ini.addValue("Processor", "EnableSSE3", itoa(config.enableSSE3));
 		ini.addValue("Processor", "EnableSSSE3", itoa(config.enableSSSE3));
 		ini.addValue("Processor", "EnableSSE4_1", itoa(config.enableSSE4_1));
+		ini.addValue("Processor", "EnableAVX", itoa(config.enableAVX));
+		ini.addValue("Processor", "EnableAVX2", itoa(config.enableAVX2));
+		ini.addValue("Processor", "EnableAVX512", itoa(config.enableAVX512));
 
 		for(int pass = 0; pass < 10; pass++)
 		{
@@ -809,6 +913,7 @@ namespace sw
 		ini.addValue("Testing", "Disable10BitMode", itoa(config.disable10BitMode));
 		ini.addValue("Testing", "FrameBufferAPI", itoa(config.frameBufferAPI));
 		ini.addValue("Testing", "Precache", itoa(config.precache));
+		ini.addValue("Testing", "PrecacheDirectory", config.precacheDirectory);
 		ini.addValue("Testing", "ShadowMapping", itoa(config.shadowMapping));
 		ini.addValue("Testing", "ForceClearRegisters", itoa(config.forceClearRegisters));
 		ini.addValue("LastModified", "Time", itoa((int)time(0)));
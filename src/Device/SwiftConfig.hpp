@@ -37,17 +37,28 @@ namespace sw
 			int vertexRoutineCacheSize;
 			int pixelRoutineCacheSize;
 			int setupRoutineCacheSize;
-			int vertexCacheSize;
+			int vertexCacheSize;   // 0 sizes the cache by its memory footprint
+			bool indexDeduplication;
 			int textureSampleQuality;
 			int mipmapQuality;
 			bool perspectiveCorrection;
 			int transcendentalPrecision;
 			int threadCount;
+			int unitCount;      // Primitive processing units, 0 = one per thread
+			int clusterCount;   // Pixel processing clusters, 0 = one per thread
+			bool tileRasterization;
+			bool coarseDepthTest;
+			bool guardBandClipping;
+			bool asyncRoutineCompilation;
+			int hotRoutineThreshold;   // Draws using an unoptimized routine before it gets optimized
 			bool enableSSE;
 			bool enableSSE2;
 			bool enableSSE3;
 			bool enableSSSE3;
 			bool enableSSE4_1;
+			bool enableAVX;
+			bool enableAVX2;
+			bool enableAVX512;
 			rr::Optimization optimization[10];
 			bool disableServer;
 			bool keepSystemCursor;
@@ -60,6 +71,7 @@ namespace sw
 			int transparencyAntialiasing;
 			int frameBufferAPI;
 			bool precache;
+			std::string precacheDirectory;
 			int shadowMapping;
 			bool forceClearRegisters;
 		#ifndef NDEBUG
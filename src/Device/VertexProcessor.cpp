@@ -18,7 +18,9 @@
 #include "Pipeline/VertexShader.hpp"
 #include "Pipeline/PixelShader.hpp"
 #include "Pipeline/Constants.hpp"
+#include "System/Hash.hpp"
 #include "System/Math.hpp"
+#include "System/Memory.hpp"
 #include "Vulkan/VkDebug.hpp"
 
 #include <string.h>
@@ -27,25 +29,69 @@ namespace sw
 {
 	bool precacheVertex = false;
 
-	void VertexCache::clear()
+	namespace
 	{
-		for(int i = 0; i < 16; i++)
+		MutexLock statisticsMutex;
+		VertexCacheStatistics statistics = {};
+	}
+
+	void VertexCache::allocate(int size)
+	{
+		if(size <= 0)
 		{
-			tag[i] = 0x80000000;
+			// Largest power of two which fits the footprint
+			size = ceilPow2((int)(VERTEX_CACHE_FOOTPRINT / sizeof(Vertex)) + 1) / 2;
 		}
+
+		size = ceilPow2(clamp(size, 4, (int)MAX_VERTEX_CACHE_SIZE));
+
+		vertex = (Vertex*)sw::allocate(size * sizeof(Vertex));
+		tag = (unsigned int*)sw::allocate(size / 4 * sizeof(unsigned int));
+		indexMask = size - 1;
+		this->size = size;
+
+		misses = 0;
+		drawCall = -1;
 	}
 
-	unsigned int VertexProcessor::States::computeHash()
+	void VertexCache::deallocate()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
+		sw::deallocate(vertex);
+		sw::deallocate(tag);
+
+		vertex = nullptr;
+		tag = nullptr;
+	}
 
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
+	void VertexCache::clear()
+	{
+		for(int i = 0; i < size / 4; i++)
 		{
-			hash ^= state[i];
+			tag[i] = 0x80000000;
 		}
+	}
 
-		return hash;
+	VertexCacheStatistics getVertexCacheStatistics()
+	{
+		statisticsMutex.lock();
+		VertexCacheStatistics current = statistics;
+		statisticsMutex.unlock();
+
+		return current;
+	}
+
+	void recordVertexCacheStatistics(int lookups, int misses)
+	{
+		statisticsMutex.lock();
+		statistics.draws++;
+		statistics.lookups += lookups;
+		statistics.misses += misses;
+		statisticsMutex.unlock();
+	}
+
+	uint64_t VertexProcessor::States::computeHash()
+	{
+		return hash64(this, sizeof(States));
 	}
 
 	VertexProcessor::State::State()
@@ -87,6 +133,8 @@ namespace sw
 
 	VertexProcessor::~VertexProcessor()
 	{
+		synchronizeRoutines();   // Pending routines may still reference shaders
+
 		delete routineCache;
 		routineCache = nullptr;
 	}
@@ -96,6 +144,11 @@ namespace sw
 		context->input[index] = stream;
 	}
 
+	void VertexProcessor::setInputBuffer(int index, const void *buffer)
+	{
+		context->input[index].buffer = buffer;
+	}
+
 	void VertexProcessor::resetInputStreams()
 	{
 		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
@@ -382,6 +435,11 @@ namespace sw
 
 	void VertexProcessor::setRoutineCacheSize(int cacheSize)
 	{
+		if(routineCache)
+		{
+			synchronizeRoutines();
+		}
+
 		delete routineCache;
 		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheVertex ? "sw-vertex" : 0);
 	}
@@ -441,18 +499,35 @@ namespace sw
 
 	Routine *VertexProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		// Vertex routines always depend on a process-local shader ID, so they're never precached
+		Routine *routine = routineCache->query(state, false);
 
 		if(!routine)   // Create one
 		{
-			VertexRoutine *generator = new VertexProgram(state, context->vertexShader);
-			generator->generate();
-			routine = (*generator)("VertexRoutine_%0.8X", state.shaderID);
-			delete generator;
+			const VertexShader *shader = context->vertexShader;
+
+			routine = routineCache->generate(state, [state, shader](bool optimize)
+			{
+				VertexRoutine *generator = new VertexProgram(state, shader);
+				generator->generate();
+				Routine *routine = optimize ? (*generator)("VertexRoutine_%0.8X", state.shaderID) :
+				                              generator->unoptimized("VertexRoutine_%0.8X", state.shaderID);
+				delete generator;
 
-			routineCache->add(state, routine);
+				return routine;
+			}, false);
 		}
 
 		return routine;
 	}
+
+	Routine *VertexProcessor::reuse(const State &state, Routine *routine)
+	{
+		return routineCache->use(routine) ? this->routine(state) : routine;
+	}
+
+	void VertexProcessor::synchronizeRoutines()
+	{
+		routineCache->synchronize();
+	}
 }
@@ -25,20 +25,44 @@ namespace sw
 {
 	struct DrawData;
 
-	struct VertexCache   // FIXME: Variable size
+	// Direct-mapped cache of processed vertices. Lines hold four consecutive
+	// indices, which are processed together by the vertex routine.
+	struct VertexCache
 	{
+		enum : unsigned int
+		{
+			SKIP_INDEX = 0xFFFFFFFF   // The output vertex is written by the caller
+		};
+
+		void allocate(int size);   // Number of vertices, 0 sizes the cache by its footprint
+		void deallocate();
 		void clear();
 
-		Vertex vertex[16][4];
-		unsigned int tag[16];
+		Vertex *vertex;          // [size]
+		unsigned int *tag;       // [size / 4]
+		unsigned int indexMask;
+		int size;
+
+		unsigned int misses;   // Lines processed by the last routine call
 
 		int drawCall;
 	};
 
+	struct VertexCacheStatistics
+	{
+		uint64_t draws;
+		uint64_t lookups;   // Vertices of the processed primitives
+		uint64_t misses;    // Lines of vertices processed by the vertex routine
+	};
+
+	VertexCacheStatistics getVertexCacheStatistics();
+	void recordVertexCacheStatistics(int lookups, int misses);
+
 	struct VertexTask
 	{
 		unsigned int vertexCount;
 		unsigned int primitiveStart;
+		int instanceID;
 		VertexCache vertexCache;
 	};
 
@@ -47,7 +71,7 @@ namespace sw
 	public:
 		struct States
 		{
-			unsigned int computeHash();
+			uint64_t computeHash();
 
 			uint64_t shaderID;
 
@@ -116,7 +140,7 @@ namespace sw
 
 			bool operator==(const State &state) const;
 
-			unsigned int hash;
+			uint64_t hash;
 		};
 
 		typedef void (*RoutinePointer)(Vertex *output, unsigned int *batch, VertexTask *vertexTask, DrawData *draw);
@@ -126,6 +150,7 @@ namespace sw
 		virtual ~VertexProcessor();
 
 		void setInputStream(int index, const Stream &stream);
+		void setInputBuffer(int index, const void *buffer);   // Keeps the stream format
 		void resetInputStreams();
 
 		void setFloatConstant(unsigned int index, const float value[4]);
@@ -170,6 +195,8 @@ namespace sw
 	protected:
 		const State update(DrawType drawType);
 		Routine *routine(const State &state);
+		Routine *reuse(const State &state, Routine *routine);   // Counts another draw with the routine of an unchanged state
+		void synchronizeRoutines();   // Waits for background routine generation
 
 		void setRoutineCacheSize(int cacheSize);
 
@@ -0,0 +1,170 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ComputeProgram.hpp"
+
+#include <algorithm>
+
+namespace sw
+{
+	ComputeScheduler::ComputeScheduler(int threadCount) : threadCount(std::max(threadCount, 1))
+	{
+		shares = new Share[this->threadCount];
+
+		worker = nullptr;
+		resume = nullptr;
+		suspend = nullptr;
+		exitThreads = false;
+	}
+
+	ComputeScheduler::~ComputeScheduler()
+	{
+		if(worker)
+		{
+			for(int i = 1; i < threadCount; i++)
+			{
+				exitThreads = true;
+				resume[i]->signal();
+				worker[i]->join();
+
+				delete worker[i];
+				delete resume[i];
+				delete suspend[i];
+			}
+
+			delete[] worker;
+			delete[] resume;
+			delete[] suspend;
+		}
+
+		delete[] shares;
+	}
+
+	void ComputeScheduler::initializeThreads()
+	{
+		worker = new Thread*[threadCount];
+		resume = new Event*[threadCount];
+		suspend = new Event*[threadCount];
+
+		worker[0] = nullptr;
+		resume[0] = nullptr;
+		suspend[0] = nullptr;
+
+		for(int i = 1; i < threadCount; i++)
+		{
+			resume[i] = new Event();
+			suspend[i] = new Event();
+
+			Parameters parameters;
+			parameters.threadIndex = i;
+			parameters.scheduler = this;
+
+			worker[i] = new Thread(threadFunction, &parameters);
+
+			suspend[i]->wait();   // Parameters have been read
+		}
+	}
+
+	void ComputeScheduler::run(Routine *routine, const uint32_t baseGroup[3], const uint32_t groupCount[3])
+	{
+		int64_t workgroupCount = (int64_t)groupCount[0] * groupCount[1] * groupCount[2];   // Can exceed 2^32
+
+		if(workgroupCount == 0)
+		{
+			return;
+		}
+
+		entry = (ComputeRoutinePointer)routine->getEntry();
+
+		for(int i = 0; i < 3; i++)
+		{
+			data.numWorkgroups[i] = groupCount[i];
+			this->baseGroup[i] = baseGroup[i];
+		}
+
+		int activeThreads = (int)std::min<int64_t>(threadCount, workgroupCount);
+
+		for(int i = 0; i < threadCount; i++)
+		{
+			shares[i].next = workgroupCount * std::min(i, activeThreads) / activeThreads;
+			shares[i].end = workgroupCount * std::min(i + 1, activeThreads) / activeThreads;
+		}
+
+		if(activeThreads > 1 && !worker)
+		{
+			initializeThreads();
+		}
+
+		for(int i = 1; i < activeThreads; i++)
+		{
+			resume[i]->signal();
+		}
+
+		work(0);
+
+		for(int i = 1; i < activeThreads; i++)
+		{
+			suspend[i]->wait();
+		}
+	}
+
+	void ComputeScheduler::threadFunction(void *parameters)
+	{
+		ComputeScheduler *scheduler = static_cast<Parameters*>(parameters)->scheduler;
+		int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
+
+		scheduler->suspend[threadIndex]->signal();
+		scheduler->threadLoop(threadIndex);
+	}
+
+	void ComputeScheduler::threadLoop(int index)
+	{
+		while(true)
+		{
+			resume[index]->wait();
+
+			if(exitThreads)
+			{
+				return;
+			}
+
+			work(index);
+
+			suspend[index]->signal();
+		}
+	}
+
+	void ComputeScheduler::work(int index)
+	{
+		// Starting with this thread's own share, then stealing from the next threads
+		for(int i = 0; i < threadCount; i++)
+		{
+			Share &share = shares[(index + i) % threadCount];
+
+			for(int64_t workgroup = share.next++; workgroup < share.end; workgroup = share.next++)
+			{
+				runWorkgroup(workgroup);
+			}
+		}
+	}
+
+	void ComputeScheduler::runWorkgroup(int64_t workgroup)
+	{
+		int x = (int)(workgroup % data.numWorkgroups[0]);
+		int y = (int)((workgroup / data.numWorkgroups[0]) % data.numWorkgroups[1]);
+		int z = (int)(workgroup / ((int64_t)data.numWorkgroups[0] * data.numWorkgroups[1]));
+
+		entry(&data, baseGroup[0] + x, baseGroup[1] + y, baseGroup[2] + z);
+	}
+}
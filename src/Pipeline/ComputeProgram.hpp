@@ -0,0 +1,85 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_ComputeProgram_hpp
+#define sw_ComputeProgram_hpp
+
+#include "Reactor/Reactor.hpp"
+#include "System/Thread.hpp"
+
+#include <atomic>
+
+namespace sw
+{
+	using namespace rr;
+
+	struct ComputeData
+	{
+		uint32_t numWorkgroups[3];
+	};
+
+	// Entry point of a routine running the invocations of one workgroup. Such routines can't
+	// be generated until SpirvShader is able to translate the instructions of a shader.
+	typedef void (*ComputeRoutinePointer)(const ComputeData *data, int workgroupX, int workgroupY, int workgroupZ);
+
+	// Runs the workgroups of a dispatch on persistent threads, which are only started by the
+	// first dispatch with more than one workgroup. Each thread starts on an equal share of the
+	// workgroups, and steals from the other threads once it runs out.
+	class ComputeScheduler
+	{
+	public:
+		ComputeScheduler(int threadCount);
+
+		~ComputeScheduler();
+
+		void run(Routine *routine, const uint32_t baseGroup[3], const uint32_t groupCount[3]);   // Returns once all workgroups have completed
+
+	private:
+		struct Share
+		{
+			std::atomic<int64_t> next;
+			int64_t end;
+
+			// Keeps the counters of different threads on separate cache lines
+			char padding[64 - sizeof(std::atomic<int64_t>) - sizeof(int64_t)];
+		};
+
+		struct Parameters
+		{
+			ComputeScheduler *scheduler;
+			int threadIndex;
+		};
+
+		static void threadFunction(void *parameters);
+		void initializeThreads();
+		void threadLoop(int index);
+		void work(int index);
+		void runWorkgroup(int64_t workgroup);
+
+		const int threadCount;   // Including the calling thread
+		Share *shares;
+
+		Thread **worker;     // Null until the first multi-threaded dispatch, index 0 is unused
+		Event **resume;      // Events for resuming threads
+		Event **suspend;     // Events for suspending threads
+		volatile bool exitThreads;
+
+		// Current dispatch
+		ComputeRoutinePointer entry;
+		ComputeData data;
+		uint32_t baseGroup[3];
+	};
+}
+
+#endif   // sw_ComputeProgram_hpp
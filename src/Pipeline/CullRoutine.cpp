@@ -0,0 +1,146 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CullRoutine.hpp"
+
+#include "Device/Clipper.hpp"
+#include "Device/Primitive.hpp"
+#include "Device/Renderer.hpp"
+
+namespace sw
+{
+	CullRoutine::CullRoutine(const SetupProcessor::State &state) : state(state)
+	{
+		routine = 0;
+	}
+
+	CullRoutine::~CullRoutine()
+	{
+	}
+
+	void CullRoutine::generate()
+	{
+		Function<Int(Pointer<Byte>, Int, Int, Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> triangles(function.Arg<0>());
+			Int count(function.Arg<1>());
+			Int drawClipFlags(function.Arg<2>());
+			Pointer<Byte> visible(function.Arg<3>());
+			Pointer<Byte> data(function.Arg<4>());
+
+			const int V[3] = {OFFSET(Triangle,v0), OFFSET(Triangle,v1), OFFSET(Triangle,v2)};
+			const int pos = state.positionRegister;
+
+			Int4 scissorX0 = Int4(*Pointer<Int>(data + OFFSET(DrawData,scissorX0)));
+			Int4 scissorX1 = Int4(*Pointer<Int>(data + OFFSET(DrawData,scissorX1)));
+			Int4 scissorY0 = Int4(*Pointer<Int>(data + OFFSET(DrawData,scissorY0)));
+			Int4 scissorY1 = Int4(*Pointer<Int>(data + OFFSET(DrawData,scissorY1)));
+
+			Int visibleCount = 0;
+
+			For(Int i = 0, i < count, i += 4)
+			{
+				Int4 X[3];
+				Int4 Y[3];
+				Int4 clipFlags[3];
+				Int4 w0w1w2 = Int4(0);
+
+				// Gather the vertices of four triangles. Past the end of the batch the
+				// last triangle is repeated, and masked out below.
+				for(int t = 0; t < 4; t++)
+				{
+					Pointer<Byte> triangle = triangles + Min(i + t, count - 1) * sizeof(Triangle);
+
+					for(int v = 0; v < 3; v++)
+					{
+						Pointer<Byte> vertex = triangle + V[v];
+
+						X[v] = Insert(X[v], *Pointer<Int>(vertex + OFFSET(Vertex,X)), t);
+						Y[v] = Insert(Y[v], *Pointer<Int>(vertex + OFFSET(Vertex,Y)), t);
+						clipFlags[v] = Insert(clipFlags[v], *Pointer<Int>(vertex + OFFSET(Vertex,clipFlags)), t);
+						w0w1w2 = Insert(w0w1w2, Extract(w0w1w2, t) ^ *Pointer<Int>(vertex + pos * 16 + 12), t);
+					}
+				}
+
+				Int4 lane = Int4(i) + Int4(0, 1, 2, 3);
+				Int4 keep = CmpLT(lane, Int4(count));
+
+				// Frustum: every vertex must be finite, and not all outside the same plane
+				keep &= CmpEQ(clipFlags[0] & clipFlags[1] & clipFlags[2], Int4(Clipper::CLIP_FINITE));
+
+				// Backface and zero area, computed exactly like the setup routine does
+				Float4 x0 = Float4(X[0]);
+				Float4 x1 = Float4(X[1]);
+				Float4 x2 = Float4(X[2]);
+
+				Float4 y0 = Float4(Y[0]);
+				Float4 y1 = Float4(Y[1]);
+				Float4 y2 = Float4(Y[2]);
+
+				Float4 A = (y2 - y0) * x1 + (y1 - y2) * x0 + (y0 - y1) * x2;   // Area
+
+				keep &= CmpNEQ(A, Float4(0.0f));
+
+				A = As<Float4>(As<Int4>(A) ^ (w0w1w2 & Int4(0x80000000)));
+
+				if(state.cullMode == CULL_CLOCKWISE)
+				{
+					keep &= CmpLT(A, Float4(0.0f));
+				}
+				else if(state.cullMode == CULL_COUNTERCLOCKWISE)
+				{
+					keep &= CmpNLE(A, Float4(0.0f));
+				}
+
+				// Triangles which don't need clipping keep their projected coordinates,
+				// so those which don't cover any pixel center of the scissor rectangle
+				// can be rejected too. Multisampling shifts the sample positions.
+				if(state.multiSample == 1)
+				{
+					Int4 unclipped = CmpEQ(clipFlags[0] | clipFlags[1] | clipFlags[2] | Int4(drawClipFlags), Int4(Clipper::CLIP_FINITE));
+
+					Int4 xMin = (Min(Min(X[0], X[1]), X[2]) + Int4(0xF)) >> 4;
+					Int4 xMax = (Max(Max(X[0], X[1]), X[2]) + Int4(0xF)) >> 4;
+					Int4 yMin = (Min(Min(Y[0], Y[1]), Y[2]) + Int4(0xF)) >> 4;
+					Int4 yMax = (Max(Max(Y[0], Y[1]), Y[2]) + Int4(0xF)) >> 4;
+
+					Int4 covered = CmpLT(xMin, xMax) & CmpLT(xMin, scissorX1) & CmpLT(scissorX0, xMax) &
+					               CmpLT(yMin, yMax) & CmpLT(yMin, scissorY1) & CmpLT(scissorY0, yMax);
+
+					keep &= covered | ~unclipped;
+				}
+
+				Int mask = SignMask(keep);
+
+				for(int t = 0; t < 4; t++)
+				{
+					If((mask & (1 << t)) != 0)
+					{
+						*Pointer<Int>(visible + visibleCount * sizeof(int)) = i + t;
+						visibleCount++;
+					}
+				}
+			}
+
+			Return(visibleCount);
+		}
+
+		routine = function("CullRoutine");
+	}
+
+	Routine *CullRoutine::getRoutine()
+	{
+		return routine;
+	}
+}
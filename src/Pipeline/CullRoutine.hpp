@@ -0,0 +1,42 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_CullRoutine_hpp
+#define sw_CullRoutine_hpp
+
+#include "Device/SetupProcessor.hpp"
+#include "Reactor/Reactor.hpp"
+
+namespace sw
+{
+	// Rejects batches of triangles four at a time, before they're clipped and set up.
+	// Only triangles which the setup routine is known to reject are removed.
+	class CullRoutine
+	{
+	public:
+		CullRoutine(const SetupProcessor::State &state);
+
+		virtual ~CullRoutine();
+
+		void generate();
+		Routine *getRoutine();
+
+	private:
+		const SetupProcessor::State &state;
+
+		Routine *routine;
+	};
+}
+
+#endif   // sw_CullRoutine_hpp
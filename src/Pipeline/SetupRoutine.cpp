@@ -217,21 +217,30 @@ namespace sw
 				}
 				Until(i >= n)
 
-				Pointer<Byte> leftEdge = Pointer<Byte>(primitive + OFFSET(Primitive,outline->left)) + q * sizeof(Primitive);
-				Pointer<Byte> rightEdge = Pointer<Byte>(primitive + OFFSET(Primitive,outline->right)) + q * sizeof(Primitive);
+				Pointer<Byte> sample = primitive + q * sizeof(Primitive);
 
-				if(state.multiSample > 1)
+				Int xMin = Xq[0];
+				Int xMax = Xq[0];
+
+				i = 1;
+
+				Do
 				{
-					Int xMin = *Pointer<Int>(data + OFFSET(DrawData, scissorX0));
-					Int xMax = *Pointer<Int>(data + OFFSET(DrawData, scissorX1));
-					Short x = Short(Clamp((X[0] + 0xF) >> 4, xMin, xMax));
+					xMin = Min(Xq[i], xMin);
+					xMax = Max(Xq[i], xMax);
 
-					For(Int y = yMin - 1, y < yMax + 1, y++)
-					{
-						*Pointer<Short>(leftEdge + y * sizeof(Primitive::Span)) = x;
-						*Pointer<Short>(rightEdge + y * sizeof(Primitive::Span)) = x;
-					}
+					i++;
 				}
+				Until(i >= n)
+
+				Int scissorX0 = *Pointer<Int>(data + OFFSET(DrawData,scissorX0));
+				Int scissorX1 = *Pointer<Int>(data + OFFSET(DrawData,scissorX1));
+
+				*Pointer<Int>(sample + OFFSET(Primitive,xMin)) = Clamp((xMin + 0xF) >> 4, scissorX0, scissorX1);
+				*Pointer<Int>(sample + OFFSET(Primitive,xMax)) = Clamp((xMax + 0xF) >> 4, scissorX0, scissorX1);
+				*Pointer<Int>(sample + OFFSET(Primitive,yTop)) = Int(0x7FFFFFFF);
+				*Pointer<Int>(sample + OFFSET(Primitive,yBottom)) = Int(0);
+				*Pointer<Int>(sample + OFFSET(Primitive,edgeCount)) = Int(0);
 
 				Xq[n] = Xq[0];
 				Yq[n] = Yq[0];
@@ -248,29 +257,21 @@ namespace sw
 					}
 					Until(i >= n)
 				}
+			}
 
-				if(state.multiSample == 1)
-				{
-					For(, yMin < yMax && *Pointer<Short>(leftEdge + yMin * sizeof(Primitive::Span)) == *Pointer<Short>(rightEdge + yMin * sizeof(Primitive::Span)), yMin++)
-					{
-						// Increments yMin
-					}
-
-					For(, yMax > yMin && *Pointer<Short>(leftEdge + (yMax - 1) * sizeof(Primitive::Span)) == *Pointer<Short>(rightEdge + (yMax - 1) * sizeof(Primitive::Span)), yMax--)
-					{
-						// Decrements yMax
-					}
-
-					If(yMin == yMax)
-					{
-						Return(false);
-					}
+			if(state.multiSample == 1)
+			{
+				// Cull primitives which don't cover any scanline of the scissor rectangle
+				Int yTop = *Pointer<Int>(primitive + OFFSET(Primitive,yTop));
+				Int yBottom = *Pointer<Int>(primitive + OFFSET(Primitive,yBottom));
 
-					*Pointer<Short>(leftEdge + (yMin - 1) * sizeof(Primitive::Span)) = *Pointer<Short>(leftEdge + yMin * sizeof(Primitive::Span));
-					*Pointer<Short>(rightEdge + (yMin - 1) * sizeof(Primitive::Span)) = *Pointer<Short>(leftEdge + yMin * sizeof(Primitive::Span));
-					*Pointer<Short>(leftEdge + yMax * sizeof(Primitive::Span)) = *Pointer<Short>(leftEdge + (yMax - 1) * sizeof(Primitive::Span));
-					*Pointer<Short>(rightEdge + yMax * sizeof(Primitive::Span)) = *Pointer<Short>(leftEdge + (yMax - 1) * sizeof(Primitive::Span));
+				If(yTop >= yBottom)
+				{
+					Return(false);
 				}
+
+				yMin = Max(yMin, yTop);
+				yMax = Min(yMax, yBottom);
 			}
 
 			*Pointer<Int>(primitive + OFFSET(Primitive,yMin)) = yMin;
@@ -566,12 +567,9 @@ namespace sw
 
 			If(y1 < y2)
 			{
-				Int xMin = *Pointer<Int>(data + OFFSET(DrawData,scissorX0));
-				Int xMax = *Pointer<Int>(data + OFFSET(DrawData,scissorX1));
-
-				Pointer<Byte> leftEdge = primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left);
-				Pointer<Byte> rightEdge = primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right);
-				Pointer<Byte> edge = IfThenElse(swap, rightEdge, leftEdge);
+				Pointer<Byte> sample = primitive + q * sizeof(Primitive);
+				Int count = *Pointer<Int>(sample + OFFSET(Primitive,edgeCount));
+				Pointer<Byte> edge = sample + OFFSET(Primitive,edge) + count * sizeof(Primitive::Edge);
 
 				// Deltas
 				Int DX12 = X2 - X1;
@@ -593,24 +591,20 @@ namespace sw
 				Q += floor;
 				R += floor & FDY12;
 
-				Int D = FDY12;   // Error-overflow
-				Int y = y1;
-
-				Do
-				{
-					*Pointer<Short>(edge + y * sizeof(Primitive::Span)) = Short(Clamp(x, xMin, xMax));
-
-					x += Q;
-					d += R;
-
-					Int overflow = -d >> 31;
-
-					d -= D & overflow;
-					x -= overflow;
-
-					y++;
-				}
-				Until(y >= y2)
+				// The rasterizer steps the edge from y1, adding Q and R per scanline and
+				// carrying into x when the error-term exceeds zero
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,y1)) = y1;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,y2)) = y2;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,x)) = x;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,d)) = d;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,Q)) = Q;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,R)) = R;
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,D)) = FDY12;   // Error-overflow
+				*Pointer<Int>(edge + OFFSET(Primitive::Edge,right)) = IfThenElse(swap, Int(1), Int(0));
+
+				*Pointer<Int>(sample + OFFSET(Primitive,edgeCount)) = count + 1;
+				*Pointer<Int>(sample + OFFSET(Primitive,yTop)) = Min(*Pointer<Int>(sample + OFFSET(Primitive,yTop)), y1);
+				*Pointer<Int>(sample + OFFSET(Primitive,yBottom)) = Max(*Pointer<Int>(sample + OFFSET(Primitive,yBottom)), y2);
 			}
 		}
 	}
@@ -15,17 +15,19 @@
 #include <spirv/unified1/spirv.hpp>
 #include "SpirvShader.hpp"
 #include "System/Math.hpp"
+#include "System/Thread.hpp"
 #include "Vulkan/VkDebug.hpp"
 #include "Device/Config.hpp"
 
 namespace sw
 {
-	volatile int SpirvShader::serialCounter = 1;    // Start at 1, 0 is invalid shader.
+	volatile int SpirvShader::serialCounter = 0;    // IDs start at 1, 0 is invalid shader.
 
 	SpirvShader::SpirvShader(InsnStore const &insns)
 			: insns{insns}, inputs{MAX_INTERFACE_COMPONENTS},
 			  outputs{MAX_INTERFACE_COMPONENTS},
-			  serialID{serialCounter++}, modes{}
+			  // Pipelines can be created concurrently
+			  serialID{atomicIncrement(&serialCounter)}, modes{}
 	{
 		// Simplifying assumptions (to be satisfied by earlier transformations)
 		// - There is exactly one entrypoint in the module, and it's the one we want
@@ -51,7 +51,7 @@ namespace sw
 
 		if(shader->isInstanceIdDeclared())
 		{
-			instanceID = *Pointer<Int>(data + OFFSET(DrawData,instanceID));
+			instanceID = *Pointer<Int>(task + OFFSET(VertexTask,instanceID));
 		}
 	}
 
@@ -42,8 +42,10 @@ namespace sw
 		const bool textureSampling = state.textureSampling;
 
 		Pointer<Byte> cache = task + OFFSET(VertexTask,vertexCache);
-		Pointer<Byte> vertexCache = cache + OFFSET(VertexCache,vertex);
-		Pointer<Byte> tagCache = cache + OFFSET(VertexCache,tag);
+		Pointer<Byte> vertexCache = *Pointer<Pointer<Byte>>(cache + OFFSET(VertexCache,vertex));
+		Pointer<Byte> tagCache = *Pointer<Pointer<Byte>>(cache + OFFSET(VertexCache,tag));
+		UInt indexMask = *Pointer<UInt>(cache + OFFSET(VertexCache,indexMask));
+		UInt misses = 0;
 
 		UInt vertexCount = *Pointer<UInt>(task + OFFSET(VertexTask,vertexCount));
 		UInt primitiveNumber = *Pointer<UInt>(task + OFFSET(VertexTask, primitiveStart));
@@ -54,25 +56,31 @@ namespace sw
 		Do
 		{
 			UInt index = *Pointer<UInt>(batch);
-			UInt tagIndex = index & 0x0000003C;
-			UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;   // FIXME: TEXLDL hack to have independent LODs, hurts performance.
 
-			If(*Pointer<UInt>(tagCache + tagIndex) != indexQ)
+			If(index != UInt(VertexCache::SKIP_INDEX))
 			{
-				*Pointer<UInt>(tagCache + tagIndex) = indexQ;
+				UInt tagIndex = index & indexMask & UInt(0xFFFFFFFC);   // First vertex of the line, and byte offset of its tag
+				UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;   // FIXME: TEXLDL hack to have independent LODs, hurts performance.
 
-				readInput(indexQ);
-				program(indexQ);
-				postTransform();
-				computeClipFlags();
+				If(*Pointer<UInt>(tagCache + tagIndex) != indexQ)
+				{
+					*Pointer<UInt>(tagCache + tagIndex) = indexQ;
 
-				Pointer<Byte> cacheLine0 = vertexCache + tagIndex * UInt((int)sizeof(Vertex));
-				writeCache(cacheLine0);
-			}
+					readInput(indexQ);
+					program(indexQ);
+					postTransform();
+					computeClipFlags();
 
-			UInt cacheIndex = index & 0x0000003F;
-			Pointer<Byte> cacheLine = vertexCache + cacheIndex * UInt((int)sizeof(Vertex));
-			writeVertex(vertex, cacheLine);
+					Pointer<Byte> cacheLine0 = vertexCache + tagIndex * UInt((int)sizeof(Vertex));
+					writeCache(cacheLine0);
+
+					misses += 1;
+				}
+
+				UInt cacheIndex = index & indexMask;
+				Pointer<Byte> cacheLine = vertexCache + cacheIndex * UInt((int)sizeof(Vertex));
+				writeVertex(vertex, cacheLine);
+			}
 
 			if(state.transformFeedbackEnabled != 0)
 			{
@@ -92,6 +100,8 @@ namespace sw
 		}
 		Until(vertexCount == 0)
 
+		*Pointer<UInt>(cache + OFFSET(VertexCache,misses)) = misses;
+
 		Return();
 	}
 
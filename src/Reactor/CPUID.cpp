@@ -36,6 +36,9 @@ namespace rr
 	bool CPUID::SSE3 = detectSSE3();
 	bool CPUID::SSSE3 = detectSSSE3();
 	bool CPUID::SSE4_1 = detectSSE4_1();
+	bool CPUID::AVX = detectAVX();
+	bool CPUID::AVX2 = detectAVX2();
+	bool CPUID::AVX512 = detectAVX512();
 
 	bool CPUID::enableMMX = true;
 	bool CPUID::enableCMOV = true;
@@ -44,6 +47,9 @@ namespace rr
 	bool CPUID::enableSSE3 = true;
 	bool CPUID::enableSSSE3 = true;
 	bool CPUID::enableSSE4_1 = true;
+	bool CPUID::enableAVX = true;
+	bool CPUID::enableAVX2 = true;
+	bool CPUID::enableAVX512 = true;
 
 	void CPUID::setEnableMMX(bool enable)
 	{
@@ -56,6 +62,9 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -70,6 +79,9 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -88,6 +100,9 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -106,6 +121,9 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -124,6 +142,9 @@ namespace rr
 		{
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -142,6 +163,9 @@ namespace rr
 		else
 		{
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
 		}
 	}
 
@@ -158,15 +182,81 @@ namespace rr
 			enableSSE3 = true;
 			enableSSSE3 = true;
 		}
+		else
+		{
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512 = false;
+		}
+	}
+
+	void CPUID::setEnableAVX(bool enable)
+	{
+		enableAVX = enable;
+
+		if(enableAVX)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+		}
+		else
+		{
+			enableAVX2 = false;
+			enableAVX512 = false;
+		}
+	}
+
+	void CPUID::setEnableAVX2(bool enable)
+	{
+		enableAVX2 = enable;
+
+		if(enableAVX2)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+			enableAVX = true;
+		}
+		else
+		{
+			enableAVX512 = false;
+		}
 	}
 
-	static void cpuid(int registers[4], int info)
+	void CPUID::setEnableAVX512(bool enable)
+	{
+		enableAVX512 = enable;
+
+		if(enableAVX512)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+			enableAVX = true;
+			enableAVX2 = true;
+		}
+	}
+
+	static void cpuid(int registers[4], int info, int subleaf = 0)
 	{
 		#if defined(__i386__) || defined(__x86_64__)
 			#if defined(_WIN32)
-				__cpuid(registers, info);
+				__cpuidex(registers, info, subleaf);
 			#else
-				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info));
+				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info), "c" (subleaf));
 			#endif
 		#else
 			registers[0] = 0;
@@ -224,4 +314,69 @@ namespace rr
 		cpuid(registers, 1);
 		return SSE4_1 = (registers[2] & 0x00080000) != 0;
 	}
+
+	// Returns the register state components the OS saves on context switches
+	static unsigned long long xgetbv(unsigned int index)
+	{
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				return _xgetbv(index);
+			#else
+				unsigned int eax, edx;
+				__asm volatile("xgetbv": "=a" (eax), "=d" (edx): "c" (index));
+				return ((unsigned long long)edx << 32) | eax;
+			#endif
+		#else
+			return 0;
+		#endif
+	}
+
+	bool CPUID::detectAVX()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		bool avx = (registers[2] & 0x10000000) != 0;
+		bool osxsave = (registers[2] & 0x08000000) != 0;
+
+		// The XMM and YMM state must both be enabled
+		return AVX = avx && osxsave && (xgetbv(0) & 0x6) == 0x6;
+	}
+
+	bool CPUID::detectAVX2()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7)
+		{
+			return AVX2 = false;
+		}
+
+		cpuid(registers, 7, 0);
+		return AVX2 = detectAVX() && (registers[1] & 0x00000020) != 0;
+	}
+
+	bool CPUID::detectAVX512()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7 || !detectAVX2())
+		{
+			return AVX512 = false;
+		}
+
+		// The opmask and all ZMM register state must be enabled too
+		if((xgetbv(0) & 0xE6) != 0xE6)
+		{
+			return AVX512 = false;
+		}
+
+		cpuid(registers, 7, 0);
+		const int F = 0x00010000;
+		const int DQ = 0x00020000;
+		const int BW = 0x40000000;
+		const int VL = (int)0x80000000;
+		return AVX512 = (registers[1] & (F | DQ | BW | VL)) == (F | DQ | BW | VL);
+	}
 }
@@ -36,6 +36,9 @@ namespace rr
 		static bool supportsSSE3();
 		static bool supportsSSSE3();
 		static bool supportsSSE4_1();
+		static bool supportsAVX();    // Also requires the OS to save the YMM registers
+		static bool supportsAVX2();
+		static bool supportsAVX512();   // The F, VL, BW and DQ subsets, as on Skylake-SP
 
 		static void setEnableMMX(bool enable);
 		static void setEnableCMOV(bool enable);
@@ -44,6 +47,9 @@ namespace rr
 		static void setEnableSSE3(bool enable);
 		static void setEnableSSSE3(bool enable);
 		static void setEnableSSE4_1(bool enable);
+		static void setEnableAVX(bool enable);
+		static void setEnableAVX2(bool enable);
+		static void setEnableAVX512(bool enable);
 
 	private:
 		static bool MMX;
@@ -53,6 +59,9 @@ namespace rr
 		static bool SSE3;
 		static bool SSSE3;
 		static bool SSE4_1;
+		static bool AVX;
+		static bool AVX2;
+		static bool AVX512;
 
 		static bool enableMMX;
 		static bool enableCMOV;
@@ -61,6 +70,9 @@ namespace rr
 		static bool enableSSE3;
 		static bool enableSSSE3;
 		static bool enableSSE4_1;
+		static bool enableAVX;
+		static bool enableAVX2;
+		static bool enableAVX512;
 
 		static bool detectMMX();
 		static bool detectCMOV();
@@ -69,6 +81,9 @@ namespace rr
 		static bool detectSSE3();
 		static bool detectSSSE3();
 		static bool detectSSE4_1();
+		static bool detectAVX();
+		static bool detectAVX2();
+		static bool detectAVX512();
 	};
 }
 
@@ -113,6 +128,21 @@ namespace rr
 	{
 		return SSE4_1 && enableSSE4_1;
 	}
+
+	inline bool CPUID::supportsAVX()
+	{
+		return AVX && enableAVX;
+	}
+
+	inline bool CPUID::supportsAVX2()
+	{
+		return AVX2 && enableAVX2;
+	}
+
+	inline bool CPUID::supportsAVX512()
+	{
+		return AVX512 && enableAVX512;
+	}
 }
 
 #endif   // rr_CPUID_hpp
@@ -15,6 +15,7 @@
 #include "ExecutableMemory.hpp"
 
 #include "Debug.hpp"
+#include "MutexLock.hpp"
 
 #if defined(_WIN32)
 	#ifndef WIN32_LEAN_AND_MEAN
@@ -34,6 +35,8 @@
 #endif
 
 #include <memory.h>
+#include <mutex>
+#include <vector>
 
 #undef allocate
 #undef deallocate
@@ -82,7 +85,7 @@ void *allocateRaw(size_t bytes, size_t alignment)
 	#endif
 }
 
-#if defined(LINUX_ENABLE_NAMED_MMAP)
+#if defined(__linux__)
 // Create a file descriptor for anonymous memory with the given
 // name. Returns -1 on failure.
 // TODO: remove once libc wrapper exists.
@@ -107,7 +110,9 @@ int memfd_create(const char* name, unsigned int flags)
 		return -1;
 	#endif
 }
+#endif  // defined(__linux__)
 
+#if defined(LINUX_ENABLE_NAMED_MMAP)
 // Returns a file descriptor for use with an anonymous mmap, if
 // memfd_create fails, -1 is returned. Note, the mappings should be
 // MAP_PRIVATE so that underlying pages aren't shared.
@@ -285,4 +290,277 @@ void deallocateExecutable(void *memory, size_t bytes)
 		deallocate(memory);
 	#endif
 }
+
+namespace
+{
+const size_t slabSize = 256 * 1024;
+const size_t codeAlignment = 64;   // Cache line
+
+struct Slab
+{
+	unsigned char *writable;
+	unsigned char *executable;   // Same as writable, unless the slab is mapped twice
+	size_t size;
+	size_t top;                  // Offset of the next allocation
+	size_t allocations;
+	size_t allocatedBytes;
+};
+
+struct CodeHeap
+{
+	MutexLock mutex;
+	std::vector<Slab*> slabs;
+	Slab *current = nullptr;     // Small allocations are made from this slab
+	bool doubleMapping = true;   // Until mapping a slab twice fails
+};
+
+CodeHeap &codeHeap()
+{
+	// Never destroyed, since routines can outlive static destructors
+	static CodeHeap *heap = new CodeHeap();
+	return *heap;
+}
+
+#if defined(__linux__)
+// Maps the same memory writable at one address and executable at another,
+// so small routines can share pages without any page being writable and
+// executable at once. Fails where executable shared mappings are denied.
+bool mapSlabTwice(Slab *slab)
+{
+	int fd = memfd_create("SwiftShader JIT", 0x0001 /* MFD_CLOEXEC */);
+	if(fd == -1)
+	{
+		return false;
+	}
+
+	void *writable = MAP_FAILED;
+	void *executable = MAP_FAILED;
+
+	if(ftruncate(fd, slab->size) == 0)
+	{
+		writable = mmap(nullptr, slab->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		executable = mmap(nullptr, slab->size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+	}
+
+	close(fd);
+
+	if(writable == MAP_FAILED || executable == MAP_FAILED)
+	{
+		if(writable != MAP_FAILED) munmap(writable, slab->size);
+		if(executable != MAP_FAILED) munmap(executable, slab->size);
+		return false;
+	}
+
+	slab->writable = (unsigned char*)writable;
+	slab->executable = (unsigned char*)executable;
+
+	return true;
+}
+#endif
+
+Slab *createSlab(CodeHeap &heap, size_t size)
+{
+	Slab *slab = new Slab();
+	slab->size = size;
+
+	#if defined(__linux__)
+		if(heap.doubleMapping && !mapSlabTwice(slab))
+		{
+			heap.doubleMapping = false;
+		}
+	#else
+		heap.doubleMapping = false;
+	#endif
+
+	if(!heap.doubleMapping)
+	{
+		slab->writable = (unsigned char*)allocateExecutable(size);
+		slab->executable = slab->writable;
+	}
+
+	if(!slab->writable)
+	{
+		delete slab;
+		return nullptr;
+	}
+
+	heap.slabs.push_back(slab);
+
+	return slab;
+}
+
+void releaseSlab(CodeHeap &heap, Slab *slab)
+{
+	if(slab->executable != slab->writable)
+	{
+		#if defined(__linux__)
+			munmap(slab->writable, slab->size);
+			munmap(slab->executable, slab->size);
+		#endif
+	}
+	else
+	{
+		deallocateExecutable(slab->writable, slab->size);
+	}
+
+	for(size_t i = 0; i < heap.slabs.size(); i++)
+	{
+		if(heap.slabs[i] == slab)
+		{
+			heap.slabs.erase(heap.slabs.begin() + i);
+			break;
+		}
+	}
+
+	delete slab;
+}
+
+Slab *findSlab(CodeHeap &heap, const void *code)
+{
+	for(Slab *slab : heap.slabs)
+	{
+		if(code >= slab->writable && code < slab->writable + slab->size)
+		{
+			return slab;
+		}
+	}
+
+	return nullptr;
+}
+
+// Pages which are made executable can't be written anymore, so unless the slab
+// is mapped twice, each allocation starts on a page of its own.
+size_t allocationAlignment(const Slab *slab)
+{
+	return (slab->executable != slab->writable) ? codeAlignment : memoryPageSize();
+}
+}  // anonymous namespace
+
+void *allocateCode(size_t bytes)
+{
+	CodeHeap &heap = codeHeap();
+	std::lock_guard<MutexLock> lock(heap.mutex);
+
+	bytes = (bytes > 0) ? bytes : 1;
+	Slab *slab = heap.current;
+	size_t offset = slab ? roundUp(slab->top, allocationAlignment(slab)) : 0;
+
+	if(!slab || offset + bytes > slab->size)
+	{
+		size_t pageSize = memoryPageSize();
+
+		if(bytes > slabSize / 4)
+		{
+			// Large routines get a slab of their own, so they don't waste the current one's remainder
+			slab = createSlab(heap, roundUp(bytes, pageSize));
+		}
+		else
+		{
+			if(heap.current && heap.current->allocations == 0)
+			{
+				releaseSlab(heap, heap.current);
+			}
+
+			slab = createSlab(heap, slabSize);
+			heap.current = slab;
+		}
+
+		if(!slab)
+		{
+			return nullptr;
+		}
+
+		offset = 0;
+	}
+
+	slab->top = offset + bytes;
+	slab->allocations++;
+	slab->allocatedBytes += bytes;
+
+	return slab->writable + offset;
+}
+
+void *executableAddress(void *code)
+{
+	CodeHeap &heap = codeHeap();
+	std::lock_guard<MutexLock> lock(heap.mutex);
+
+	Slab *slab = findSlab(heap, code);
+	ASSERT(slab);
+
+	return slab->executable + ((unsigned char*)code - slab->writable);
+}
+
+void markCodeExecutable(void *code, size_t bytes)
+{
+	void *executable = executableAddress(code);
+
+	if(executable == code)
+	{
+		// The allocation is the only one on its pages
+		markExecutable(code, roundUp(bytes, memoryPageSize()));
+	}
+
+	#if defined(_WIN32)
+		FlushInstructionCache(GetCurrentProcess(), executable, bytes);
+	#else
+		__builtin___clear_cache((char*)executable, (char*)executable + bytes);
+	#endif
+}
+
+void deallocateCode(void *code, size_t bytes)
+{
+	if(!code)
+	{
+		return;
+	}
+
+	CodeHeap &heap = codeHeap();
+	std::lock_guard<MutexLock> lock(heap.mutex);
+
+	Slab *slab = findSlab(heap, code);
+	ASSERT(slab);
+
+	slab->allocations--;
+	slab->allocatedBytes -= (bytes > 0) ? bytes : 1;
+
+	if(slab->allocations == 0)
+	{
+		if(slab != heap.current)
+		{
+			releaseSlab(heap, slab);
+		}
+		else if(slab->executable != slab->writable)
+		{
+			slab->top = 0;   // No code runs from the slab anymore, so it can be reused
+		}
+	}
+}
+
+CodeHeapStatistics getCodeHeapStatistics()
+{
+	CodeHeap &heap = codeHeap();
+	std::lock_guard<MutexLock> lock(heap.mutex);
+
+	CodeHeapStatistics statistics = {};
+
+	for(const Slab *slab : heap.slabs)
+	{
+		statistics.slabs++;
+		statistics.allocations += slab->allocations;
+		statistics.reservedBytes += slab->size;
+		statistics.allocatedBytes += slab->allocatedBytes;
+	}
+
+	if(heap.current)
+	{
+		const Slab *slab = heap.current;
+		size_t offset = roundUp(slab->top, allocationAlignment(slab));
+		statistics.freeBytes = (offset < slab->size) ? slab->size - offset : 0;
+	}
+
+	statistics.wastedBytes = statistics.reservedBytes - statistics.allocatedBytes - statistics.freeBytes;
+
+	return statistics;
+}
 }
@@ -27,6 +27,28 @@ void *allocateExecutable(size_t bytes);   // Allocates memory that can be made e
 void markExecutable(void *memory, size_t bytes);
 void deallocateExecutable(void *memory, size_t bytes);
 
+// Routines are suballocated from shared slabs of executable memory, instead of
+// each occupying whole pages and a mapping of their own. Code is written at the
+// address returned by allocateCode(), and runs at executableAddress() of it,
+// which differs when slabs are mapped twice. The code can't be modified after
+// markCodeExecutable().
+void *allocateCode(size_t bytes);
+void *executableAddress(void *code);
+void markCodeExecutable(void *code, size_t bytes);
+void deallocateCode(void *code, size_t bytes);   // Slabs are released once all their code is
+
+struct CodeHeapStatistics
+{
+	size_t slabs;
+	size_t allocations;      // Live
+	size_t reservedBytes;    // Size of all slabs
+	size_t allocatedBytes;   // Requested by live allocations
+	size_t freeBytes;        // Still available for allocation
+	size_t wastedBytes;      // Alignment, executable page remainders and unreclaimed code
+};
+
+CodeHeapStatistics getCodeHeapStatistics();
+
 template<typename P>
 P unaligned_read(P *address)
 {
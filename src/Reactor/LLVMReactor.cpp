@@ -47,6 +47,7 @@
 	#include "llvm/Analysis/LoopPass.h"
 	#include "llvm/ExecutionEngine/ExecutionEngine.h"
 	#include "llvm/ExecutionEngine/JITSymbol.h"
+	#include "llvm/ExecutionEngine/ObjectCache.h"
 	#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 	#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 	#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
@@ -81,6 +82,8 @@
 
 #include <numeric>
 #include <fstream>
+#include <mutex>
+#include <vector>
 
 #if defined(__i386__) || defined(__x86_64__)
 #include <xmmintrin.h>
@@ -109,13 +112,18 @@ namespace rr
 
 namespace
 {
-	rr::LLVMReactorJIT *reactorJIT = nullptr;
-	llvm::IRBuilder<> *builder = nullptr;
-	llvm::LLVMContext *context = nullptr;
-	llvm::Module *module = nullptr;
-	llvm::Function *function = nullptr;
+	// Code generation state of the calling thread's Nucleus
+	thread_local rr::LLVMReactorJIT *reactorJIT = nullptr;
+	thread_local llvm::IRBuilder<> *builder = nullptr;
+	thread_local llvm::LLVMContext *context = nullptr;
+	thread_local llvm::Module *module = nullptr;
+	thread_local llvm::Function *function = nullptr;
 
-	rr::MutexLock codegenMutex;
+	std::once_flag targetInitialized;
+
+#if REACTOR_LLVM_VERSION < 7
+	rr::MutexLock codegenMutex;   // The legacy JIT is not thread safe
+#endif
 
 #if REACTOR_LLVM_VERSION >= 7
 	llvm::Value *lowerPAVG(llvm::Value *x, llvm::Value *y)
@@ -547,17 +555,48 @@ namespace rr
 		}
 	};
 
+	// Never provides precompiled objects, but records the last compiled one
+	// so routines can hand out their object code when retainObjectCode is set.
+	class ObjectRecorder : public llvm::ObjectCache
+	{
+	public:
+		void notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) override
+		{
+			if(retainObjectCode)
+			{
+				lastObject.assign(object.getBufferStart(), object.getBufferEnd());
+			}
+		}
+
+		std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *module) override
+		{
+			return nullptr;
+		}
+
+		std::string lastObject;
+	};
+
+	// Each JIT is used by one Nucleus at a time, so independent routines can be
+	// compiled concurrently. Idle JITs are pooled for reuse by any thread.
 	class LLVMReactorJIT
 	{
 	private:
 		using ObjLayer = llvm::orc::RTDyldObjectLinkingLayer;
 		using CompileLayer = llvm::orc::IRCompileLayer<ObjLayer, llvm::orc::SimpleCompiler>;
 
+		static rr::MutexLock poolMutex;
+		static std::vector<LLVMReactorJIT*> idleJITs;
+
+		llvm::LLVMContext llvmContext;
+		llvm::IRBuilder<> irBuilder;
+		rr::MutexLock layerMutex;   // Routines can be released by any thread
+
 		llvm::orc::ExecutionSession session;
 		ExternalFunctionSymbolResolver externalSymbolResolver;
 		std::shared_ptr<llvm::orc::SymbolResolver> resolver;
 		std::unique_ptr<llvm::TargetMachine> targetMachine;
 		const llvm::DataLayout dataLayout;
+		ObjectRecorder objectRecorder;
 		ObjLayer objLayer;
 		CompileLayer compileLayer;
 		size_t emittedFunctionsNum;
@@ -565,6 +604,7 @@ namespace rr
 	public:
 		LLVMReactorJIT(const char *arch, const llvm::SmallVectorImpl<std::string>& mattrs,
 					   const llvm::TargetOptions &targetOpts):
+			irBuilder(llvmContext),
 			resolver(createLegacyLookupResolver(
 				session,
 				[this](const std::string &name) {
@@ -597,20 +637,46 @@ namespace rr
 						std::make_shared<llvm::SectionMemoryManager>(),
 						resolver};
 				}),
-			compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine)),
+			compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine, &objectRecorder)),
 			emittedFunctionsNum(0)
 		{
 		}
 
+		static LLVMReactorJIT *acquire(const char *arch, const llvm::SmallVectorImpl<std::string>& mattrs,
+		                               const llvm::TargetOptions &targetOpts)
+		{
+			{
+				std::lock_guard<rr::MutexLock> lock(poolMutex);
+
+				if(!idleJITs.empty())
+				{
+					LLVMReactorJIT *jit = idleJITs.back();
+					idleJITs.pop_back();
+					return jit;
+				}
+			}
+
+			return new LLVMReactorJIT(arch, mattrs, targetOpts);
+		}
+
 		void startSession()
 		{
+			::context = &llvmContext;
+			::builder = &irBuilder;
 			::module = new llvm::Module("", *::context);
 		}
 
 		void endSession()
 		{
+			delete ::module;   // Only still owned when no routine was acquired
+
 			::function = nullptr;
 			::module = nullptr;
+			::builder = nullptr;
+			::context = nullptr;
+
+			std::lock_guard<rr::MutexLock> lock(poolMutex);
+			idleJITs.push_back(this);
 		}
 
 		LLVMRoutine *acquireRoutine(llvm::Function *func)
@@ -624,6 +690,8 @@ namespace rr
 			::module = nullptr;
 			mod->setDataLayout(dataLayout);
 
+			std::lock_guard<rr::MutexLock> lock(layerMutex);
+
 			auto moduleKey = session.allocateVModule();
 			llvm::cantFail(compileLayer.addModule(moduleKey, std::move(mod)));
 
@@ -641,6 +709,57 @@ namespace rr
 				return nullptr;
 			}
 
+			void *addr = reinterpret_cast<void *>(static_cast<intptr_t>(expectAddr.get()));
+			LLVMRoutine *routine = new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey);
+
+			if(retainObjectCode && !objectRecorder.lastObject.empty())
+			{
+				std::string object = mangledName;
+				object.push_back('\0');
+				object.append(objectRecorder.lastObject);
+				objectRecorder.lastObject.clear();
+
+				routine->setObject(std::move(object));
+			}
+
+			return routine;
+		}
+
+		LLVMRoutine *loadRoutine(const void *object, size_t size)
+		{
+			const char *mangledName = static_cast<const char*>(object);
+			size_t nameLength = strnlen(mangledName, size);
+
+			if(nameLength == 0 || nameLength == size)
+			{
+				return nullptr;
+			}
+
+			llvm::StringRef code(mangledName + nameLength + 1, size - nameLength - 1);
+
+			std::lock_guard<rr::MutexLock> lock(layerMutex);
+
+			auto moduleKey = session.allocateVModule();
+			if(llvm::Error error = objLayer.addObject(moduleKey, llvm::MemoryBuffer::getMemBufferCopy(code)))
+			{
+				llvm::consumeError(std::move(error));
+				return nullptr;
+			}
+
+			llvm::JITSymbol symbol = objLayer.findSymbolIn(moduleKey, mangledName, false);
+
+			llvm::Expected<llvm::JITTargetAddress> expectAddr = symbol.getAddress();
+			if(!expectAddr || !expectAddr.get())
+			{
+				if(!expectAddr)
+				{
+					llvm::consumeError(expectAddr.takeError());
+				}
+
+				llvm::cantFail(objLayer.removeObject(moduleKey));
+				return nullptr;
+			}
+
 			void *addr = reinterpret_cast<void *>(static_cast<intptr_t>(expectAddr.get()));
 			return new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey);
 		}
@@ -677,6 +796,7 @@ namespace rr
 	private:
 		void releaseRoutineModule(llvm::orc::VModuleKey moduleKey)
 		{
+			std::lock_guard<rr::MutexLock> lock(layerMutex);
 			llvm::cantFail(compileLayer.removeModule(moduleKey));
 		}
 
@@ -685,9 +805,13 @@ namespace rr
 			jit->releaseRoutineModule(moduleKey);
 		}
 	};
+
+	rr::MutexLock LLVMReactorJIT::poolMutex;
+	std::vector<LLVMReactorJIT*> LLVMReactorJIT::idleJITs;
 #endif
 
 	Optimization optimization[10] = {InstructionCombining, Disabled};
+	bool retainObjectCode = false;
 
 	enum EmulatedType
 	{
@@ -798,19 +922,19 @@ namespace rr
 
 	Nucleus::Nucleus()
 	{
-		::codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
+#if REACTOR_LLVM_VERSION < 7
+		::codegenMutex.lock();
+#endif
 
-		llvm::InitializeNativeTarget();
+		std::call_once(::targetInitialized, []()
+		{
+			llvm::InitializeNativeTarget();
 
 #if REACTOR_LLVM_VERSION >= 7
-		llvm::InitializeNativeTargetAsmPrinter();
-		llvm::InitializeNativeTargetAsmParser();
+			llvm::InitializeNativeTargetAsmPrinter();
+			llvm::InitializeNativeTargetAsmParser();
 #endif
-
-		if(!::context)
-		{
-			::context = new llvm::LLVMContext();
-		}
+		});
 
 		#if defined(__x86_64__)
 			static const char arch[] = "x86-64";
@@ -842,6 +966,14 @@ namespace rr
 		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse41"  : "-sse41");
 #else
 		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse4.1" : "-sse4.1");
+		mattrs.push_back(CPUID::supportsAVX()    ? "+avx"    : "-avx");
+		mattrs.push_back(CPUID::supportsAVX2()   ? "+avx2"   : "-avx2");
+		mattrs.push_back(CPUID::supportsAVX512() ? "+avx512f"  : "-avx512f");
+		mattrs.push_back(CPUID::supportsAVX512() ? "+avx512vl" : "-avx512vl");
+		mattrs.push_back(CPUID::supportsAVX512() ? "+avx512bw" : "-avx512bw");
+		mattrs.push_back(CPUID::supportsAVX512() ? "+avx512dq" : "-avx512dq");
+		// Keeps vectorized loops from using 512-bit registers, which lower the clock frequency
+		mattrs.push_back("+prefer-256-bit");
 #endif
 #elif defined(__arm__)
 #if __ARM_ARCH >= 8
@@ -864,28 +996,29 @@ namespace rr
 		// targetOpts.NoNaNsFPMath = true;
 #endif
 
-		if(!::reactorJIT)
-		{
 #if REACTOR_LLVM_VERSION < 7
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs);
+		static llvm::LLVMContext *legacyContext = new llvm::LLVMContext();
+		static llvm::IRBuilder<> *legacyBuilder = new llvm::IRBuilder<>(*legacyContext);
+		static LLVMReactorJIT *legacyJIT = new LLVMReactorJIT(arch, mattrs);
+
+		::context = legacyContext;
+		::builder = legacyBuilder;
+		::reactorJIT = legacyJIT;
 #else
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs, targetOpts);
+		::reactorJIT = LLVMReactorJIT::acquire(arch, mattrs, targetOpts);
 #endif
-		}
 
 		::reactorJIT->startSession();
-
-		if(!::builder)
-		{
-			::builder = new llvm::IRBuilder<>(*::context);
-		}
 	}
 
 	Nucleus::~Nucleus()
 	{
 		::reactorJIT->endSession();
+		::reactorJIT = nullptr;
 
+#if REACTOR_LLVM_VERSION < 7
 		::codegenMutex.unlock();
+#endif
 	}
 
 	Routine *Nucleus::acquireRoutine(const char *name, bool runOptimizations)
@@ -940,6 +1073,17 @@ namespace rr
 		return routine;
 	}
 
+	Routine *Nucleus::loadRoutine(const void *object, size_t size)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		return nullptr;   // The legacy JIT emits directly into executable memory
+#else
+		Nucleus nucleus;   // Acquires a JIT for this thread
+
+		return ::reactorJIT->loadRoutine(object, size);
+#endif
+	}
+
 	void Nucleus::optimize()
 	{
 		::reactorJIT->optimize(::module);
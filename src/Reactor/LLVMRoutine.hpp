@@ -18,6 +18,7 @@
 #include "Routine.hpp"
 
 #include <cstdint>
+#include <string>
 
 namespace rr
 {
@@ -69,8 +70,20 @@ namespace rr
 			return entry;
 		}
 
+		const void *getObject(size_t &size)
+		{
+			size = object.size();
+			return object.empty() ? nullptr : object.data();
+		}
+
+		void setObject(std::string &&symbolAndObject)
+		{
+			object = std::move(symbolAndObject);
+		}
+
 	private:
 		const void *entry;
+		std::string object;   // Entry symbol name, null terminated, followed by the object file
 
 		void (*dtor)(LLVMReactorJIT *, uint64_t);
 		LLVMReactorJIT *reactorJIT;
@@ -17,6 +17,7 @@
 
 #include <cassert>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -45,6 +46,7 @@ namespace rr
 	};
 
 	extern Optimization optimization[10];
+	extern bool retainObjectCode;   // Keep routines' object code, see Routine::getObject()
 
 	class Nucleus
 	{
@@ -55,6 +57,9 @@ namespace rr
 
 		Routine *acquireRoutine(const char *name, bool runOptimizations = true);
 
+		// Returns null if the object code can't be loaded by this backend
+		static Routine *loadRoutine(const void *object, size_t size);
+
 		static Value *allocateStackVariable(Type *type, int arraySize = 0);
 		static BasicBlock *createBasicBlock();
 		static BasicBlock *getInsertBlock();
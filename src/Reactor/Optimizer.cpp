@@ -17,10 +17,74 @@
 #include "src/IceCfg.h"
 #include "src/IceCfgNode.h"
 
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
 namespace
 {
+	int typeBits(Ice::Type type)
+	{
+		return (type == Ice::IceType_i1) ? 1 : static_cast<int>(Ice::typeWidthInBytes(type)) * 8;
+	}
+
+	uint64_t zeroExtend(int64_t value, int bits)
+	{
+		return (bits < 64) ? (value & ((1ull << bits) - 1)) : value;
+	}
+
+	int64_t signExtend(int64_t value, int bits)
+	{
+		return (bits < 64) ? static_cast<int64_t>(zeroExtend(value, bits) << (64 - bits)) >> (64 - bits) : value;
+	}
+
+	bool constantValue(const Ice::Operand *operand, int64_t &value)
+	{
+		if(auto *constant = llvm::dyn_cast<Ice::ConstantInteger32>(operand))
+		{
+			value = constant->getValue();
+			return true;
+		}
+
+		if(auto *constant = llvm::dyn_cast<Ice::ConstantInteger64>(operand))
+		{
+			value = constant->getValue();
+			return true;
+		}
+
+		return false;
+	}
+
+	bool foldArithmetic(Ice::InstArithmetic::OpKind op, int bits, int64_t x, int64_t y, int64_t &result)
+	{
+		uint64_t ux = zeroExtend(x, bits);
+		uint64_t uy = zeroExtend(y, bits);
+		int64_t sx = signExtend(x, bits);
+		int64_t sy = signExtend(y, bits);
+		int64_t minimum = signExtend(1ull << (bits - 1), bits);
+
+		switch(op)
+		{
+		case Ice::InstArithmetic::Add:  result = ux + uy; break;
+		case Ice::InstArithmetic::Sub:  result = ux - uy; break;
+		case Ice::InstArithmetic::Mul:  result = ux * uy; break;
+		case Ice::InstArithmetic::And:  result = ux & uy; break;
+		case Ice::InstArithmetic::Or:   result = ux | uy; break;
+		case Ice::InstArithmetic::Xor:  result = ux ^ uy; break;
+		case Ice::InstArithmetic::Shl:  if(uy >= (uint64_t)bits) return false; result = ux << uy; break;
+		case Ice::InstArithmetic::Lshr: if(uy >= (uint64_t)bits) return false; result = ux >> uy; break;
+		case Ice::InstArithmetic::Ashr: if(uy >= (uint64_t)bits) return false; result = sx >> uy; break;
+		case Ice::InstArithmetic::Udiv: if(uy == 0) return false; result = ux / uy; break;
+		case Ice::InstArithmetic::Urem: if(uy == 0) return false; result = ux % uy; break;
+		case Ice::InstArithmetic::Sdiv: if(sy == 0 || (sy == -1 && sx == minimum)) return false; result = sx / sy; break;
+		case Ice::InstArithmetic::Srem: if(sy == 0 || (sy == -1 && sx == minimum)) return false; result = sx % sy; break;
+		default:
+			return false;
+		}
+
+		return true;
+	}
+
 	class Optimizer
 	{
 	public:
@@ -32,6 +96,15 @@ namespace
 		void eliminateUnitializedLoads();
 		void eliminateLoadsFollowingSingleStore();
 		void optimizeStoresInSingleBasicBlock();
+		void foldConstants();
+		void eliminateCommonSubexpressions();
+		void hoistLoopInvariants();
+
+		void computeDominators();
+		bool dominates(Ice::CfgNode *dominator, Ice::CfgNode *node) const;
+		bool isLoopInvariant(Ice::Inst *instruction, const std::vector<bool> &loop);
+		Ice::Inst *dominatingSingleStore(Ice::Inst *load);
+		Ice::Operand *fold(const Ice::Inst *instruction) const;
 
 		void replace(Ice::Inst *instruction, Ice::Operand *newValue);
 		void deleteInstruction(Ice::Inst *instruction);
@@ -46,10 +119,14 @@ namespace
 		static Ice::Operand *storeData(const Ice::Inst *instruction);
 		static std::size_t storeSize(const Ice::Inst *instruction);
 		static bool loadTypeMatchesStore(const Ice::Inst *load, const Ice::Inst *store);
+		static bool isPure(const Ice::Inst *instruction);
 
 		Ice::Cfg *function;
 		Ice::GlobalContext *context;
 
+		std::vector<Ice::CfgNode*> reversePostOrder;     // Of the reachable nodes
+		std::vector<Ice::CfgNode*> immediateDominator;   // Indexed by node, null when unreachable
+
 		struct Uses : std::vector<Ice::Inst*>
 		{
 			bool areOnlyLoadStore() const;
@@ -89,6 +166,24 @@ namespace
 		bool hasLoadStoreInsts(Ice::CfgNode* node) const;
 
 		std::vector<Optimizer::Uses*> allocatedUses;
+
+		// Identifies the value computed by a pure instruction
+		struct Expression
+		{
+			Expression(const Ice::Inst *instruction);
+
+			bool operator==(const Expression &other) const;
+
+			struct Hash
+			{
+				size_t operator()(const Expression &expression) const;
+			};
+
+			Ice::Inst::InstKind kind;
+			int op;   // Arithmetic or cast operation, or comparison condition
+			Ice::Type type;
+			Ice::Operand *src[3];
+		};
 	};
 
 	void Optimizer::run(Ice::Cfg *function)
@@ -97,11 +192,15 @@ namespace
 		this->context = function->getContext();
 
 		analyzeUses(function);
+		computeDominators();
 
 		eliminateDeadCode();
 		eliminateUnitializedLoads();
 		eliminateLoadsFollowingSingleStore();
 		optimizeStoresInSingleBasicBlock();
+		foldConstants();
+		hoistLoopInvariants();
+		eliminateCommonSubexpressions();
 		eliminateDeadCode();
 
 		for(auto uses : allocatedUses)
@@ -427,6 +526,394 @@ namespace
 		}
 	}
 
+	void Optimizer::foldConstants()
+	{
+		bool modified;
+		do
+		{
+			modified = false;
+			for(Ice::CfgNode *basicBlock : function->getNodes())
+			{
+				for(Ice::Inst &inst : basicBlock->getInsts())
+				{
+					if(inst.isDeleted() || !inst.getDest())
+					{
+						continue;
+					}
+
+					if(Ice::Operand *value = fold(&inst))
+					{
+						replace(&inst, value);
+						modified = true;
+					}
+				}
+			}
+		}
+		while(modified);
+	}
+
+	void Optimizer::eliminateCommonSubexpressions()
+	{
+		std::unordered_map<Expression, std::vector<Ice::Inst*>, Expression::Hash> available;
+
+		// Dominating blocks are visited first, and the instructions they compute remain available
+		// in the blocks they dominate. Sources are replaced before an instruction is visited,
+		// so chains of equivalent expressions get eliminated in a single pass.
+		for(Ice::CfgNode *basicBlock : reversePostOrder)
+		{
+			for(Ice::Inst &inst : basicBlock->getInsts())
+			{
+				if(inst.isDeleted())
+				{
+					continue;
+				}
+
+				// Variables stored to once are known in all the blocks the store dominates
+				if(isLoad(inst))
+				{
+					if(Ice::Inst *store = dominatingSingleStore(&inst))
+					{
+						replace(&inst, storeData(store));
+					}
+
+					continue;
+				}
+
+				if(!isPure(&inst))
+				{
+					continue;
+				}
+
+				std::vector<Ice::Inst*> &candidates = available[Expression(&inst)];
+				Ice::Inst *equivalent = nullptr;
+
+				for(Ice::Inst *candidate : candidates)
+				{
+					if(!candidate->isDeleted() && dominates(getNode(candidate), basicBlock))
+					{
+						equivalent = candidate;
+						break;
+					}
+				}
+
+				if(equivalent)
+				{
+					replace(&inst, equivalent->getDest());
+				}
+				else
+				{
+					candidates.push_back(&inst);
+				}
+			}
+		}
+	}
+
+	void Optimizer::hoistLoopInvariants()
+	{
+		struct Loop
+		{
+			Ice::CfgNode *preheader;
+			std::vector<bool> body;   // Indexed by node
+			size_t size;
+		};
+
+		std::vector<Loop> loops;
+		size_t nodeCount = function->getNodes().size();
+
+		for(Ice::CfgNode *header : reversePostOrder)
+		{
+			Loop loop = { nullptr, std::vector<bool>(nodeCount, false), 1 };
+			loop.body[header->getIndex()] = true;
+
+			// Back edges lead to a block which dominates their source
+			std::vector<Ice::CfgNode*> worklist;
+
+			for(Ice::CfgNode *predecessor : header->getInEdges())
+			{
+				if(dominates(header, predecessor))
+				{
+					worklist.push_back(predecessor);
+				}
+			}
+
+			if(worklist.empty())
+			{
+				continue;
+			}
+
+			while(!worklist.empty())
+			{
+				Ice::CfgNode *node = worklist.back();
+				worklist.pop_back();
+
+				if(!loop.body[node->getIndex()])
+				{
+					loop.body[node->getIndex()] = true;
+					loop.size++;
+
+					for(Ice::CfgNode *predecessor : node->getInEdges())
+					{
+						worklist.push_back(predecessor);
+					}
+				}
+			}
+
+			// Only hoist into a single block which enters the loop, and leads nowhere else
+			for(Ice::CfgNode *predecessor : header->getInEdges())
+			{
+				if(!loop.body[predecessor->getIndex()])
+				{
+					bool unique = !loop.preheader;
+					loop.preheader = unique ? predecessor : nullptr;
+
+					if(!unique)
+					{
+						break;
+					}
+				}
+			}
+
+			if(loop.preheader && loop.preheader->getOutEdges().size() == 1 &&
+			   llvm::isa<Ice::InstBr>(loop.preheader->getInsts().back()))
+			{
+				loops.push_back(std::move(loop));
+			}
+		}
+
+		// Inner loops first, so their invariants can be hoisted further by the enclosing loops
+		std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) { return a.size < b.size; });
+
+		for(const Loop &loop : loops)
+		{
+			Ice::InstList &preheaderInsts = loop.preheader->getInsts();
+			Ice::Inst *terminator = &preheaderInsts.back();
+
+			// In reverse post-order, definitions are visited before their uses
+			for(Ice::CfgNode *basicBlock : reversePostOrder)
+			{
+				if(!loop.body[basicBlock->getIndex()])
+				{
+					continue;
+				}
+
+				Ice::InstList &insts = basicBlock->getInsts();
+
+				for(auto iterator = insts.begin(); iterator != insts.end();)
+				{
+					Ice::Inst *inst = &*iterator++;
+
+					if(!inst->isDeleted() && isLoopInvariant(inst, loop.body))
+					{
+						insts.remove(inst);
+						preheaderInsts.insert(terminator->getIterator(), inst);
+						setNode(inst, loop.preheader);
+					}
+				}
+			}
+		}
+	}
+
+	Ice::Inst *Optimizer::dominatingSingleStore(Ice::Inst *load)
+	{
+		Ice::Variable *address = llvm::dyn_cast<Ice::Variable>(loadAddress(load));
+		Ice::Inst *definition = address ? getDefinition(address) : nullptr;
+
+		if(!definition || !llvm::isa<Ice::InstAlloca>(definition) || !getUses(address)->areOnlyLoadStore())
+		{
+			return nullptr;
+		}
+
+		const Uses &uses = *getUses(address);
+
+		if(uses.stores.size() != 1)
+		{
+			return nullptr;
+		}
+
+		// Loads in the same block as the store have already been handled
+		Ice::Inst *store = uses.stores[0];
+		Ice::CfgNode *storeNode = getNode(store);
+		Ice::CfgNode *loadNode = getNode(load);
+
+		if(storeNode == loadNode || !dominates(storeNode, loadNode) || !loadTypeMatchesStore(load, store))
+		{
+			return nullptr;
+		}
+
+		return store;
+	}
+
+	bool Optimizer::isLoopInvariant(Ice::Inst *instruction, const std::vector<bool> &loop)
+	{
+		if(isLoad(*instruction))
+		{
+			// Loads of variables which aren't stored to within the loop
+			Ice::Variable *address = llvm::dyn_cast<Ice::Variable>(loadAddress(instruction));
+			Ice::Inst *definition = address ? getDefinition(address) : nullptr;
+
+			if(!definition || !llvm::isa<Ice::InstAlloca>(definition) || !getUses(address)->areOnlyLoadStore())
+			{
+				return false;
+			}
+
+			for(Ice::Inst *store : getUses(address)->stores)
+			{
+				if(loop[getNode(store)->getIndex()])
+				{
+					return false;
+				}
+			}
+		}
+		else if(!isPure(instruction))
+		{
+			return false;
+		}
+
+		for(Ice::SizeT i = 0; i < instruction->getSrcSize(); i++)
+		{
+			if(Ice::Variable *var = llvm::dyn_cast<Ice::Variable>(instruction->getSrc(i)))
+			{
+				Ice::Inst *definition = getDefinition(var);   // Null for arguments
+
+				if(definition && loop[getNode(definition)->getIndex()])
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	Ice::Operand *Optimizer::fold(const Ice::Inst *instruction) const
+	{
+		Ice::Type type = instruction->getDest()->getType();
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(instruction))
+		{
+			// Floating-point operations aren't folded, since they depend on the denormal mode at run time
+			if(!Ice::isScalarIntegerType(type))
+			{
+				return nullptr;
+			}
+
+			Ice::Operand *x = arithmetic->getSrc(0);
+			Ice::Operand *y = arithmetic->getSrc(1);
+			int64_t a = 0;
+			int64_t b = 0;
+			bool constantX = constantValue(x, a);
+			bool constantY = constantValue(y, b);
+			int bits = typeBits(type);
+
+			if(constantX && constantY)
+			{
+				int64_t result;
+				return foldArithmetic(arithmetic->getOp(), bits, a, b, result) ? context->getConstantInt(type, result) : nullptr;
+			}
+
+			bool zeroX = constantX && zeroExtend(a, bits) == 0;
+			bool zeroY = constantY && zeroExtend(b, bits) == 0;
+			bool oneX = constantX && zeroExtend(a, bits) == 1;
+			bool oneY = constantY && zeroExtend(b, bits) == 1;
+			bool onesX = constantX && zeroExtend(a, bits) == zeroExtend(-1, bits);
+			bool onesY = constantY && zeroExtend(b, bits) == zeroExtend(-1, bits);
+
+			switch(arithmetic->getOp())
+			{
+			case Ice::InstArithmetic::Add:
+			case Ice::InstArithmetic::Or:
+			case Ice::InstArithmetic::Xor:
+				if(zeroY) return x;
+				if(zeroX) return y;
+				break;
+			case Ice::InstArithmetic::Sub:
+			case Ice::InstArithmetic::Shl:
+			case Ice::InstArithmetic::Lshr:
+			case Ice::InstArithmetic::Ashr:
+				if(zeroY) return x;
+				break;
+			case Ice::InstArithmetic::Mul:
+				if(oneY) return x;
+				if(oneX) return y;
+				if(zeroX || zeroY) return context->getConstantZero(type);
+				break;
+			case Ice::InstArithmetic::And:
+				if(onesY) return x;
+				if(onesX) return y;
+				if(zeroX || zeroY) return context->getConstantZero(type);
+				break;
+			default:
+				break;
+			}
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(instruction))
+		{
+			Ice::Type srcType = icmp->getSrc(0)->getType();
+			int64_t a = 0;
+			int64_t b = 0;
+
+			if(!Ice::isScalarIntegerType(srcType) || !constantValue(icmp->getSrc(0), a) || !constantValue(icmp->getSrc(1), b))
+			{
+				return nullptr;
+			}
+
+			int bits = typeBits(srcType);
+			uint64_t ua = zeroExtend(a, bits);
+			uint64_t ub = zeroExtend(b, bits);
+			int64_t sa = signExtend(a, bits);
+			int64_t sb = signExtend(b, bits);
+			bool result = false;
+
+			switch(icmp->getCondition())
+			{
+			case Ice::InstIcmp::Eq:  result = (ua == ub); break;
+			case Ice::InstIcmp::Ne:  result = (ua != ub); break;
+			case Ice::InstIcmp::Ugt: result = (ua > ub);  break;
+			case Ice::InstIcmp::Uge: result = (ua >= ub); break;
+			case Ice::InstIcmp::Ult: result = (ua < ub);  break;
+			case Ice::InstIcmp::Ule: result = (ua <= ub); break;
+			case Ice::InstIcmp::Sgt: result = (sa > sb);  break;
+			case Ice::InstIcmp::Sge: result = (sa >= sb); break;
+			case Ice::InstIcmp::Slt: result = (sa < sb);  break;
+			case Ice::InstIcmp::Sle: result = (sa <= sb); break;
+			default:
+				return nullptr;
+			}
+
+			return context->getConstantInt1(result ? 1 : 0);
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(instruction))
+		{
+			Ice::Type srcType = cast->getSrc(0)->getType();
+			int64_t a = 0;
+
+			if(!Ice::isScalarIntegerType(type) || !Ice::isScalarIntegerType(srcType) || !constantValue(cast->getSrc(0), a))
+			{
+				return nullptr;
+			}
+
+			switch(cast->getCastKind())
+			{
+			case Ice::InstCast::Trunc: return context->getConstantInt(type, a);
+			case Ice::InstCast::Zext:  return context->getConstantInt(type, zeroExtend(a, typeBits(srcType)));
+			case Ice::InstCast::Sext:  return context->getConstantInt(type, signExtend(a, typeBits(srcType)));
+			default:
+				break;
+			}
+		}
+		else if(auto *select = llvm::dyn_cast<Ice::InstSelect>(instruction))
+		{
+			int64_t condition = 0;
+
+			if(constantValue(select->getCondition(), condition))
+			{
+				return (condition & 1) ? select->getTrueOperand() : select->getFalseOperand();
+			}
+		}
+
+		return nullptr;
+	}
+
 	void Optimizer::analyzeUses(Ice::Cfg *function)
 	{
 		for(Ice::CfgNode *basicBlock : function->getNodes())
@@ -465,6 +952,114 @@ namespace
 		}
 	}
 
+	void Optimizer::computeDominators()
+	{
+		size_t nodeCount = function->getNodes().size();
+		Ice::CfgNode *entry = function->getEntryNode();
+
+		// Depth-first search for the post-order of the reachable nodes
+		std::vector<Ice::CfgNode*> postOrder;
+		std::vector<std::pair<Ice::CfgNode*, size_t>> stack;
+		std::vector<bool> visited(nodeCount, false);
+
+		stack.push_back({entry, 0});
+		visited[entry->getIndex()] = true;
+
+		while(!stack.empty())
+		{
+			Ice::CfgNode *node = stack.back().first;
+			size_t next = stack.back().second++;
+
+			if(next < node->getOutEdges().size())
+			{
+				Ice::CfgNode *successor = node->getOutEdges()[next];
+
+				if(!visited[successor->getIndex()])
+				{
+					visited[successor->getIndex()] = true;
+					stack.push_back({successor, 0});
+				}
+			}
+			else
+			{
+				postOrder.push_back(node);
+				stack.pop_back();
+			}
+		}
+
+		reversePostOrder.assign(postOrder.rbegin(), postOrder.rend());
+
+		std::vector<size_t> order(nodeCount, 0);
+		for(size_t i = 0; i < reversePostOrder.size(); i++)
+		{
+			order[reversePostOrder[i]->getIndex()] = i;
+		}
+
+		// Iterative algorithm by Cooper, Harvey and Kennedy
+		immediateDominator.assign(nodeCount, nullptr);
+		immediateDominator[entry->getIndex()] = entry;
+
+		bool modified;
+		do
+		{
+			modified = false;
+			for(size_t i = 1; i < reversePostOrder.size(); i++)
+			{
+				Ice::CfgNode *node = reversePostOrder[i];
+				Ice::CfgNode *dominator = nullptr;
+
+				for(Ice::CfgNode *predecessor : node->getInEdges())
+				{
+					if(!immediateDominator[predecessor->getIndex()])
+					{
+						continue;   // Not processed yet
+					}
+
+					if(!dominator)
+					{
+						dominator = predecessor;
+						continue;
+					}
+
+					Ice::CfgNode *a = predecessor;
+					Ice::CfgNode *b = dominator;
+
+					while(a != b)
+					{
+						while(order[a->getIndex()] > order[b->getIndex()]) a = immediateDominator[a->getIndex()];
+						while(order[b->getIndex()] > order[a->getIndex()]) b = immediateDominator[b->getIndex()];
+					}
+
+					dominator = a;
+				}
+
+				if(immediateDominator[node->getIndex()] != dominator)
+				{
+					immediateDominator[node->getIndex()] = dominator;
+					modified = true;
+				}
+			}
+		}
+		while(modified);
+	}
+
+	bool Optimizer::dominates(Ice::CfgNode *dominator, Ice::CfgNode *node) const
+	{
+		while(node != dominator)
+		{
+			Ice::CfgNode *parent = immediateDominator[node->getIndex()];
+
+			if(!parent || parent == node)
+			{
+				return false;   // Unreachable, or reached the entry
+			}
+
+			node = parent;
+		}
+
+		return true;
+	}
+
 	void Optimizer::replace(Ice::Inst *instruction, Ice::Operand *newValue)
 	{
 		Ice::Variable *oldValue = instruction->getDest();
@@ -707,6 +1302,39 @@ namespace
 		return false;
 	}
 
+	bool Optimizer::isPure(const Ice::Inst *instruction)
+	{
+		if(!instruction->getDest())
+		{
+			return false;
+		}
+
+		switch(instruction->getKind())
+		{
+		case Ice::Inst::Arithmetic:
+			// Integer division can trap, so it must not be executed speculatively
+			switch(llvm::cast<Ice::InstArithmetic>(instruction)->getOp())
+			{
+			case Ice::InstArithmetic::Udiv:
+			case Ice::InstArithmetic::Sdiv:
+			case Ice::InstArithmetic::Urem:
+			case Ice::InstArithmetic::Srem:
+				return false;
+			default:
+				return true;
+			}
+		case Ice::Inst::Cast:
+		case Ice::Inst::ExtractElement:
+		case Ice::Inst::Fcmp:
+		case Ice::Inst::Icmp:
+		case Ice::Inst::InsertElement:
+		case Ice::Inst::Select:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	Optimizer::Uses* Optimizer::getUses(Ice::Operand* operand)
 	{
 		Optimizer::Uses* uses = (Optimizer::Uses*)operand->Ice::Operand::getExternalData();
@@ -824,6 +1452,57 @@ namespace
 			}
 		}
 	}
+	Optimizer::Expression::Expression(const Ice::Inst *instruction)
+	{
+		kind = instruction->getKind();
+		op = 0;
+		type = instruction->getDest()->getType();
+
+		for(Ice::SizeT i = 0; i < 3; i++)
+		{
+			src[i] = (i < instruction->getSrcSize()) ? instruction->getSrc(i) : nullptr;
+		}
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(instruction))
+		{
+			op = arithmetic->getOp();
+
+			if(arithmetic->isCommutative() && src[1] < src[0])
+			{
+				std::swap(src[0], src[1]);
+			}
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(instruction))
+		{
+			op = cast->getCastKind();
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(instruction))
+		{
+			op = icmp->getCondition();
+		}
+		else if(auto *fcmp = llvm::dyn_cast<Ice::InstFcmp>(instruction))
+		{
+			op = fcmp->getCondition();
+		}
+	}
+
+	bool Optimizer::Expression::operator==(const Expression &other) const
+	{
+		return kind == other.kind && op == other.op && type == other.type &&
+		       src[0] == other.src[0] && src[1] == other.src[1] && src[2] == other.src[2];
+	}
+
+	size_t Optimizer::Expression::Hash::operator()(const Expression &expression) const
+	{
+		size_t hash = (expression.kind * 31 + expression.op) * 31 + expression.type;
+
+		for(Ice::Operand *src : expression.src)
+		{
+			hash = hash * 31 + std::hash<Ice::Operand*>()(src);
+		}
+
+		return hash;
+	}
 }
 
 namespace rr
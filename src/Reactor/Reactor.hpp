@@ -2259,6 +2259,9 @@ namespace rr
 
 		Routine *operator()(const char *name, ...);
 
+		// Skips the optimization passes, for routines which are needed sooner than they need to be fast
+		Routine *unoptimized(const char *name, ...);
+
 	protected:
 		Nucleus *core;
 		std::vector<Type*> arguments;
@@ -2769,6 +2772,19 @@ namespace rr
 		return core->acquireRoutine(fullName, true);
 	}
 
+	template<typename Return, typename... Arguments>
+	Routine *Function<Return(Arguments...)>::unoptimized(const char *name, ...)
+	{
+		char fullName[1024 + 1];
+
+		va_list vararg;
+		va_start(vararg, name);
+		vsnprintf(fullName, 1024, name, vararg);
+		va_end(vararg);
+
+		return core->acquireRoutine(fullName, false);
+	}
+
 	template<class T, class S>
 	RValue<T> ReinterpretCast(RValue<S> val)
 	{
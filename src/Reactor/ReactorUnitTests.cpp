@@ -13,9 +13,13 @@
 // limitations under the License.
 
 #include "Reactor.hpp"
+#include "ExecutableMemory.hpp"
 
 #include "gtest/gtest.h"
 
+#include <thread>
+#include <vector>
+
 using namespace rr;
 
 int reference(int *p, int y)
@@ -454,6 +458,80 @@ TEST(ReactorUnitTests, Branching)
 	delete routine;
 }
 
+TEST(ReactorUnitTests, Optimizations)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Int, Int, Pointer<Int>)> function;
+		{
+			Int a = function.Arg<0>();
+			Int b = function.Arg<1>();
+			Pointer<Int> p = function.Arg<2>();
+
+			// Constant expressions, including shifts and sign changes
+			Int c = (Int(6) * Int(7) - Int(2)) >> 2;
+			UInt u = UInt(0x80000000u) >> 31;
+			Int s = Int(-8) >> 1;
+			Int x = c + Int(u) * 100 + s * 1000 + (a & Int(-1)) + (b | Int(0));
+
+			// Common subexpressions in dominated blocks
+			Int ab = a * b + a;
+			If(a > b)
+			{
+				x += a * b + a;
+			}
+			Else
+			{
+				x -= a * b + a;
+			}
+
+			// Loop invariant expressions and loads
+			Int sum = 0;
+			For(Int i = 0, i < 10, i++)
+			{
+				sum += ab * 3 + c + i;
+				p[i] = (a ^ b) + i;
+			}
+
+			Return(x + sum);
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			int(*callable)(int, int, int*) = (int(*)(int, int, int*))routine->getEntry();
+
+			for(int a = -3; a <= 3; a++)
+			{
+				for(int b = -3; b <= 3; b++)
+				{
+					int out[10] = {};
+					int c = (6 * 7 - 2) >> 2;
+					int x = c + 1 * 100 + -4 * 1000 + a + b;
+					x += (a > b) ? (a * b + a) : -(a * b + a);
+
+					int sum = 0;
+					for(int i = 0; i < 10; i++)
+					{
+						sum += (a * b + a) * 3 + c + i;
+					}
+
+					EXPECT_EQ(callable(a, b, out), x + sum);
+
+					for(int i = 0; i < 10; i++)
+					{
+						EXPECT_EQ(out[i], (a ^ b) + i);
+					}
+				}
+			}
+		}
+	}
+
+	delete routine;
+}
+
 TEST(ReactorUnitTests, MinMax)
 {
 	Routine *routine = nullptr;
@@ -992,6 +1070,109 @@ TEST(ReactorUnitTests, MulAdd)
 	delete routine;
 }
 
+TEST(ReactorUnitTests, MultiThreadedCodegen)
+{
+	const int threadCount = 8;
+	const int iterations = 16;
+
+	std::vector<std::thread> threads;
+	std::vector<int> failures(threadCount, 0);
+
+	for(int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([t, &failures]()
+		{
+			for(int n = 0; n < iterations; n++)
+			{
+				const int c = t * iterations + n;
+				Routine *routine = nullptr;
+
+				{
+					Function<Int(Pointer<Int>, Int)> function;
+					{
+						Pointer<Int> p = function.Arg<0>();
+						Int x = p[-1];
+						Int y = function.Arg<1>();
+						Int z = 4;
+
+						For(Int i = 0, i < 10, i++)
+						{
+							z += (2 << i) - (i / 3);
+						}
+
+						Int sum = x + y + z + c;
+
+						Return(sum);
+					}
+
+					routine = function("thread%d_%d", t, n);
+				}
+
+				int (*callable)(int*, int) = (int(*)(int*,int))routine->getEntry();
+				int one[2] = {1, 0};
+
+				if(callable(&one[1], 2) != reference(&one[1], 2) + c)
+				{
+					failures[t]++;
+				}
+
+				delete routine;
+			}
+		});
+	}
+
+	for(auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	for(int t = 0; t < threadCount; t++)
+	{
+		EXPECT_EQ(failures[t], 0);
+	}
+}
+
+TEST(ReactorUnitTests, CodeHeap)
+{
+	const int count = 64;
+	const size_t size = 100;
+
+	CodeHeapStatistics before = getCodeHeapStatistics();
+
+	unsigned char *code[count];
+
+	for(int i = 0; i < count; i++)
+	{
+		code[i] = (unsigned char*)allocateCode(size);
+		ASSERT_NE(code[i], nullptr);
+
+		memset(code[i], i, size);
+		markCodeExecutable(code[i], size);
+	}
+
+	CodeHeapStatistics during = getCodeHeapStatistics();
+	EXPECT_EQ(during.allocations, before.allocations + count);
+	EXPECT_EQ(during.allocatedBytes, before.allocatedBytes + count * size);
+	EXPECT_EQ(during.reservedBytes, during.allocatedBytes + during.freeBytes + during.wastedBytes);
+
+	for(int i = 0; i < count; i++)
+	{
+		const unsigned char *executable = (const unsigned char*)executableAddress(code[i]);
+		EXPECT_EQ(executable[0], i);
+		EXPECT_EQ(executable[size - 1], i);
+	}
+
+	for(int i = 0; i < count; i++)
+	{
+		deallocateCode(code[i], size);
+	}
+
+	CodeHeapStatistics after = getCodeHeapStatistics();
+	EXPECT_EQ(after.allocations, before.allocations);
+	EXPECT_EQ(after.allocatedBytes, before.allocatedBytes);
+	EXPECT_LE(after.slabs, during.slabs);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -44,4 +44,10 @@ namespace rr
 	{
 		assert(bindCount == 0);
 	}
+
+	const void *Routine::getObject(size_t &size)
+	{
+		size = 0;
+		return nullptr;
+	}
 }
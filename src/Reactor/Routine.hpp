@@ -15,6 +15,8 @@
 #ifndef rr_Routine_hpp
 #define rr_Routine_hpp
 
+#include <cstddef>
+
 namespace rr
 {
 	class Routine
@@ -26,6 +28,11 @@ namespace rr
 
 		virtual const void *getEntry() = 0;
 
+		// Relocatable object code which Nucleus::loadRoutine() can turn back into
+		// a routine, also in another process. Only kept when retainObjectCode is
+		// set, and null for backends which can't reload their output.
+		virtual const void *getObject(size_t &size);
+
 		// Reference counting
 		void bind();
 		void unbind();
@@ -55,16 +55,18 @@
 
 namespace
 {
-	Ice::GlobalContext *context = nullptr;
-	Ice::Cfg *function = nullptr;
-	Ice::CfgNode *basicBlock = nullptr;
-	Ice::CfgLocalAllocatorScope *allocator = nullptr;
-	rr::Routine *routine = nullptr;
-
-	std::mutex codegenMutex;
-
-	Ice::ELFFileStreamer *elfFile = nullptr;
-	Ice::Fdstream *out = nullptr;
+	// Each thread generates code into its own Ice::GlobalContext, so routines
+	// can be built concurrently.
+	thread_local Ice::GlobalContext *context = nullptr;
+	thread_local Ice::Cfg *function = nullptr;
+	thread_local Ice::CfgNode *basicBlock = nullptr;
+	thread_local Ice::CfgLocalAllocatorScope *allocator = nullptr;
+	thread_local rr::Routine *routine = nullptr;
+
+	std::once_flag flagsInitialized;
+
+	thread_local Ice::ELFFileStreamer *elfFile = nullptr;
+	thread_local Ice::Fdstream *out = nullptr;
 }
 
 namespace
@@ -199,6 +201,7 @@ namespace rr
 	}
 
 	Optimization optimization[10] = {InstructionCombining, Disabled};
+	bool retainObjectCode = false;
 
 	using ElfHeader = std::conditional<sizeof(void*) == 8, Elf64_Ehdr, Elf32_Ehdr>::type;
 	using SectionHeader = std::conditional<sizeof(void*) == 8, Elf64_Shdr, Elf32_Shdr>::type;
@@ -213,7 +216,8 @@ namespace rr
 		return &sectionHeader(elfHeader)[index];
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf32_Rel &relocation, const SectionHeader &relocationTable)
+	// The image is written at elfHeader, and executes at executableOffset bytes from it
+	static void *relocateSymbol(const ElfHeader *elfHeader, intptr_t executableOffset, const Elf32_Rel &relocation, const SectionHeader &relocationTable)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -240,7 +244,7 @@ namespace rr
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + executableOffset + symbol.st_value + target->sh_offset);
 			}
 			else
 			{
@@ -298,7 +302,7 @@ namespace rr
 		return symbolValue;
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf64_Rela &relocation, const SectionHeader &relocationTable)
+	static void *relocateSymbol(const ElfHeader *elfHeader, intptr_t executableOffset, const Elf64_Rela &relocation, const SectionHeader &relocationTable)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -325,7 +329,7 @@ namespace rr
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + executableOffset + symbol.st_value + target->sh_offset);
 			}
 			else
 			{
@@ -346,7 +350,7 @@ namespace rr
 			*patchSite64 = (int64_t)((intptr_t)symbolValue + *patchSite64 + relocation.r_addend);
 			break;
 		case R_X86_64_PC32:
-			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 - (intptr_t)patchSite32 + relocation.r_addend);
+			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 - (address + executableOffset + relocation.r_offset) + relocation.r_addend);
 			break;
 		case R_X86_64_32S:
 			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 + relocation.r_addend);
@@ -359,7 +363,7 @@ namespace rr
 		return symbolValue;
 	}
 
-	void *loadImage(uint8_t *const elfImage, size_t &codeSize)
+	void *loadImage(uint8_t *const elfImage, intptr_t executableOffset)
 	{
 		ElfHeader *elfHeader = (ElfHeader*)elfImage;
 
@@ -393,8 +397,7 @@ namespace rr
 			{
 				if(sectionHeader[i].sh_flags & SHF_EXECINSTR)
 				{
-					entry = elfImage + sectionHeader[i].sh_offset;
-					codeSize = sectionHeader[i].sh_size;
+					entry = elfImage + executableOffset + sectionHeader[i].sh_offset;
 				}
 			}
 			else if(sectionHeader[i].sh_type == SHT_REL)
@@ -404,7 +407,7 @@ namespace rr
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf32_Rel &relocation = ((const Elf32_Rel*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, executableOffset, relocation, sectionHeader[i]);
 				}
 			}
 			else if(sectionHeader[i].sh_type == SHT_RELA)
@@ -414,7 +417,7 @@ namespace rr
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf64_Rela &relocation = ((const Elf64_Rela*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, executableOffset, relocation, sectionHeader[i]);
 				}
 			}
 		}
@@ -422,47 +425,27 @@ namespace rr
 		return entry;
 	}
 
-	template<typename T>
-	struct ExecutableAllocator
-	{
-		ExecutableAllocator() {};
-		template<class U> ExecutableAllocator(const ExecutableAllocator<U> &other) {};
-
-		using value_type = T;
-		using size_type = std::size_t;
-
-		T *allocate(size_type n)
-		{
-			return (T*)allocateExecutable(sizeof(T) * n);
-		}
-
-		void deallocate(T *p, size_type n)
-		{
-			deallocateExecutable(p, sizeof(T) * n);
-		}
-	};
-
 	class ELFMemoryStreamer : public Ice::ELFStreamer, public Routine
 	{
 		ELFMemoryStreamer(const ELFMemoryStreamer &) = delete;
 		ELFMemoryStreamer &operator=(const ELFMemoryStreamer &) = delete;
 
 	public:
-		ELFMemoryStreamer() : Routine(), entry(nullptr)
+		ELFMemoryStreamer() : Routine(), entry(nullptr), image(nullptr), imageSize(0)
 		{
 			position = 0;
 			buffer.reserve(0x1000);
 		}
 
+		ELFMemoryStreamer(const void *object, size_t size) : Routine(), entry(nullptr), image(nullptr), imageSize(0)
+		{
+			position = 0;
+			writeBytes(llvm::StringRef(static_cast<const char*>(object), size));
+		}
+
 		~ELFMemoryStreamer() override
 		{
-			#if defined(_WIN32)
-				if(buffer.size() != 0)
-				{
-					DWORD exeProtection;
-					VirtualProtect(&buffer[0], buffer.size(), oldProtection, &exeProtection);
-				}
-			#endif
+			deallocateCode(image, imageSize);
 		}
 
 		void write8(uint8_t Value) override
@@ -498,53 +481,73 @@ namespace rr
 			{
 				position = std::numeric_limits<std::size_t>::max();   // Can't stream more data after this
 
-				size_t codeSize = 0;
-				entry = loadImage(&buffer[0], codeSize);
+				// Small routines share the code heap's pages, instead of each streaming into pages of their own
+				if(!buffer.empty())
+				{
+					image = (uint8_t*)allocateCode(buffer.size());
+				}
 
-				#if defined(_WIN32)
-					VirtualProtect(&buffer[0], buffer.size(), PAGE_EXECUTE_READ, &oldProtection);
-					FlushInstructionCache(GetCurrentProcess(), NULL, 0);
-				#else
-					mprotect(&buffer[0], buffer.size(), PROT_READ | PROT_EXEC);
-					__builtin___clear_cache((char*)entry, (char*)entry + codeSize);
-				#endif
+				if(image)
+				{
+					imageSize = buffer.size();
+					memcpy(image, &buffer[0], imageSize);
+
+					intptr_t executableOffset = (intptr_t)executableAddress(image) - (intptr_t)image;
+					entry = loadImage(image, executableOffset);
+					markCodeExecutable(image, imageSize);
+				}
+
+				std::vector<uint8_t>().swap(buffer);
 			}
 
 			return entry;
 		}
 
+		const void *getObject(size_t &size) override
+		{
+			size = object.size();
+			return object.empty() ? nullptr : &object[0];
+		}
+
+		void retainObject()
+		{
+			// Loading relocates the image, and releases the buffer
+			object.assign(buffer.begin(), buffer.end());
+		}
+
 	private:
 		void *entry;
-		std::vector<uint8_t, ExecutableAllocator<uint8_t>> buffer;
+		uint8_t *image;   // Loaded into the code heap
+		size_t imageSize;
+		std::vector<uint8_t> buffer;
+		std::vector<uint8_t> object;
 		std::size_t position;
-
-		#if defined(_WIN32)
-		DWORD oldProtection;
-		#endif
 	};
 
 	Nucleus::Nucleus()
 	{
-		::codegenMutex.lock();   // Reactor is currently not thread safe
-
-		Ice::ClFlags &Flags = Ice::ClFlags::Flags;
-		Ice::ClFlags::getParsedClFlags(Flags);
+		// The flags are process-wide, and identical for all routines
+		std::call_once(::flagsInitialized, []()
+		{
+			Ice::ClFlags &Flags = Ice::ClFlags::Flags;
+			Ice::ClFlags::getParsedClFlags(Flags);
 
-		#if defined(__arm__)
-			Flags.setTargetArch(Ice::Target_ARM32);
-			Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
-		#elif defined(__mips__)
-			Flags.setTargetArch(Ice::Target_MIPS32);
-			Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
-		#else   // x86
-			Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
-			Flags.setTargetInstructionSet(CPUID::SSE4_1 ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
-		#endif
-		Flags.setOutFileType(Ice::FT_Elf);
-		Flags.setOptLevel(Ice::Opt_2);
-		Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
-		Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
-		Flags.setDisableHybridAssembly(true);
+			#if defined(__arm__)
+				Flags.setTargetArch(Ice::Target_ARM32);
+				Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
+			#elif defined(__mips__)
+				Flags.setTargetArch(Ice::Target_MIPS32);
+				Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
+			#else   // x86
+				Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
+				Flags.setTargetInstructionSet(CPUID::SSE4_1 ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
+			#endif
+			Flags.setOutFileType(Ice::FT_Elf);
+			Flags.setOptLevel(Ice::Opt_2);
+			Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
+			Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
+			Flags.setDisableHybridAssembly(true);
+		});
 
 		static llvm::raw_os_ostream cout(std::cout);
 		static llvm::raw_os_ostream cerr(std::cerr);
@@ -575,7 +578,12 @@ namespace rr
 		delete ::elfFile;
 		delete ::out;
 
-		::codegenMutex.unlock();
+		::routine = nullptr;
+		::allocator = nullptr;
+		::function = nullptr;
+		::context = nullptr;
+		::elfFile = nullptr;
+		::out = nullptr;
 	}
 
 	Routine *Nucleus::acquireRoutine(const char *name, bool runOptimizations)
@@ -587,7 +595,22 @@ namespace rr
 
 		::function->setFunctionName(Ice::GlobalString::createWithString(::context, name));
 
-		optimize();
+		// Blocks started after a Return() may remain empty. Terminate them, so the
+		// control flow edges can be computed for the optimizer and liveness analysis.
+		for(Ice::CfgNode *node : ::function->getNodes())
+		{
+			if(node->getInsts().empty())
+			{
+				node->appendInst(Ice::InstUnreachable::create(::function));
+			}
+		}
+
+		::function->computeInOutEdges();
+
+		if(runOptimizations)
+		{
+			optimize();
+		}
 
 		::function->translate();
 		assert(!::function->hasError());
@@ -611,12 +634,36 @@ namespace rr
 		objectWriter->setUndefinedSyms(::context->getConstantExternSyms());
 		objectWriter->writeNonUserSections();
 
+		if(retainObjectCode && ::routine)
+		{
+			static_cast<ELFMemoryStreamer*>(::routine)->retainObject();
+		}
+
 		Routine *handoffRoutine = ::routine;
 		::routine = nullptr;
 
 		return handoffRoutine;
 	}
 
+	Routine *Nucleus::loadRoutine(const void *object, size_t size)
+	{
+		if(size < sizeof(ElfHeader))
+		{
+			return nullptr;
+		}
+
+		// Subzero's ELF images have no external symbols, so they load anywhere
+		ELFMemoryStreamer *routine = new ELFMemoryStreamer(object, size);
+
+		if(!routine->getEntry())
+		{
+			delete routine;
+			return nullptr;
+		}
+
+		return routine;
+	}
+
 	void Nucleus::optimize()
 	{
 		rr::optimize(::function);
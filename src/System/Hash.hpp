@@ -0,0 +1,116 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_Hash_hpp
+#define sw_Hash_hpp
+
+#include "Types.hpp"
+
+#include <string.h>
+
+namespace sw
+{
+	// 64-bit xxHash. Large inputs are consumed as four independent lanes,
+	// which keeps the multipliers pipelined and lets compilers vectorize.
+	inline uint64_t hash64(const void *data, size_t size, uint64_t seed = 0)
+	{
+		const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+		const uint64_t prime3 = 0x165667B19E3779F9ull;
+		const uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+		const uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+		struct Util
+		{
+			static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+			static uint64_t read64(const unsigned char *p) { uint64_t x; memcpy(&x, p, 8); return x; }
+			static uint32_t read32(const unsigned char *p) { uint32_t x; memcpy(&x, p, 4); return x; }
+
+			static uint64_t round(uint64_t lane, uint64_t input)
+			{
+				lane += input * prime2;
+				lane = rotl(lane, 31);
+				return lane * prime1;
+			}
+
+			static uint64_t merge(uint64_t hash, uint64_t lane)
+			{
+				hash ^= round(0, lane);
+				return hash * prime1 + prime4;
+			}
+		};
+
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		const unsigned char *end = bytes + size;
+		uint64_t hash;
+
+		if(size >= 32)
+		{
+			uint64_t lane[4] = {seed + prime1 + prime2, seed + prime2, seed, seed - prime1};
+
+			do
+			{
+				for(int i = 0; i < 4; i++)
+				{
+					lane[i] = Util::round(lane[i], Util::read64(bytes + 8 * i));
+				}
+
+				bytes += 32;
+			}
+			while(bytes + 32 <= end);
+
+			hash = Util::rotl(lane[0], 1) + Util::rotl(lane[1], 7) + Util::rotl(lane[2], 12) + Util::rotl(lane[3], 18);
+
+			for(int i = 0; i < 4; i++)
+			{
+				hash = Util::merge(hash, lane[i]);
+			}
+		}
+		else
+		{
+			hash = seed + prime5;
+		}
+
+		hash += size;
+
+		for(; bytes + 8 <= end; bytes += 8)
+		{
+			hash ^= Util::round(0, Util::read64(bytes));
+			hash = Util::rotl(hash, 27) * prime1 + prime4;
+		}
+
+		if(bytes + 4 <= end)
+		{
+			hash ^= Util::read32(bytes) * prime1;
+			hash = Util::rotl(hash, 23) * prime2 + prime3;
+			bytes += 4;
+		}
+
+		for(; bytes < end; bytes++)
+		{
+			hash ^= *bytes * prime5;
+			hash = Util::rotl(hash, 11) * prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+}
+
+#endif   // sw_Hash_hpp
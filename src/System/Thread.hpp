@@ -120,6 +120,7 @@ namespace sw
 	int atomicIncrement(int volatile *value);
 	int atomicDecrement(int volatile *value);
 	int atomicAdd(int volatile *target, int value);
+	int atomicCompareExchange(int volatile *target, int exchange, int comparand);
 	void nop();
 }
 
@@ -285,6 +286,15 @@ namespace sw
 		#endif
 	}
 
+	inline int atomicCompareExchange(volatile int *target, int exchange, int comparand)
+	{
+		#if defined(_WIN32)
+			return InterlockedCompareExchange((volatile long*)target, exchange, comparand);
+		#else
+			return __sync_val_compare_and_swap(target, comparand, exchange);
+		#endif
+	}
+
 	inline void nop()
 	{
 		#if defined(_WIN32)
@@ -310,6 +320,7 @@ namespace sw
 			inline int operator++(int) { return ai.fetch_add(1, std::memory_order_acq_rel) + 1; }
 			inline void operator-=(int i) { ai.fetch_sub(i, std::memory_order_acq_rel); }
 			inline void operator+=(int i) { ai.fetch_add(i, std::memory_order_acq_rel); }
+			inline bool compareExchange(int comparand, int exchange) { return ai.compare_exchange_strong(comparand, exchange, std::memory_order_acq_rel); }
 		private:
 			std::atomic<int> ai;
 		};
@@ -329,6 +340,7 @@ namespace sw
 			inline int operator++(int) { return sw::atomicIncrement(&vi); }
 			inline void operator-=(int i) { sw::atomicAdd(&vi, -i); }
 			inline void operator+=(int i) { sw::atomicAdd(&vi, i); }
+			inline bool compareExchange(int comparand, int exchange) { return sw::atomicCompareExchange(&vi, exchange, comparand) == comparand; }
 		private:
 			volatile int vi;
 		};
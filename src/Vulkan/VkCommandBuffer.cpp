@@ -22,16 +22,20 @@
 #include "Device/Renderer.hpp"
 
 #include <cstring>
+#include <type_traits>
 
 namespace vk
 {
 
+// Commands are placement constructed in the command buffer's chunks, and never
+// destroyed. Any additional data they need must be allocated from the chunks too.
 class CommandBuffer::Command
 {
 public:
 	// FIXME (b/119421344): change the commandBuffer argument to a CommandBuffer state
 	virtual void play(CommandBuffer::ExecutionState& executionState) = 0;
-	virtual ~Command() {}
+
+	Command* next = nullptr;   // In recording order
 };
 
 class BeginRenderPass : public CommandBuffer::Command
@@ -40,16 +44,8 @@ public:
 	BeginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkRect2D renderArea,
 	                uint32_t clearValueCount, const VkClearValue* pClearValues) :
 		renderPass(Cast(renderPass)), framebuffer(Cast(framebuffer)), renderArea(renderArea),
-		clearValueCount(clearValueCount)
-	{
-		// FIXME (b/119409619): use an allocator here so we can control all memory allocations
-		clearValues = new VkClearValue[clearValueCount];
-		memcpy(clearValues, pClearValues, clearValueCount * sizeof(VkClearValue));
-	}
-
-	~BeginRenderPass() override
+		clearValueCount(clearValueCount), clearValues(pClearValues)
 	{
-		delete [] clearValues;
 	}
 
 protected:
@@ -66,7 +62,7 @@ private:
 	Framebuffer* framebuffer;
 	VkRect2D renderArea;
 	uint32_t clearValueCount;
-	VkClearValue* clearValues;
+	const VkClearValue* clearValues;   // Copied into the command buffer
 };
 
 class NextSubpass : public CommandBuffer::Command
@@ -139,6 +135,59 @@ struct VertexBufferBind : public CommandBuffer::Command
 	const VkDeviceSize offset;
 };
 
+struct Dispatch : public CommandBuffer::Command
+{
+	Dispatch(uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+		: baseGroup{baseGroupX, baseGroupY, baseGroupZ}, groupCount{groupCountX, groupCountY, groupCountZ}
+	{
+	}
+
+	void play(CommandBuffer::ExecutionState& executionState)
+	{
+		ComputePipeline* pipeline = static_cast<ComputePipeline*>(
+			executionState.pipelines[VK_PIPELINE_BIND_POINT_COMPUTE]);
+		if(!pipeline)
+		{
+			return;   // Invalid usage, dispatching requires a bound compute pipeline
+		}
+
+		pipeline->run(executionState.computeScheduler, baseGroup, groupCount);
+	}
+
+private:
+	uint32_t baseGroup[3];
+	uint32_t groupCount[3];
+};
+
+struct DispatchIndirect : public CommandBuffer::Command
+{
+	DispatchIndirect(VkBuffer buffer, VkDeviceSize offset)
+		: buffer(buffer), offset(offset)
+	{
+	}
+
+	void play(CommandBuffer::ExecutionState& executionState)
+	{
+		// The group counts are read when the command executes, not when it's recorded
+		auto cmd = reinterpret_cast<const VkDispatchIndirectCommand*>(Cast(buffer)->getOffsetPointer(offset));
+		const uint32_t baseGroup[3] = { 0, 0, 0 };
+		const uint32_t groupCount[3] = { cmd->x, cmd->y, cmd->z };
+
+		ComputePipeline* pipeline = static_cast<ComputePipeline*>(
+			executionState.pipelines[VK_PIPELINE_BIND_POINT_COMPUTE]);
+		if(!pipeline)
+		{
+			return;   // Invalid usage, dispatching requires a bound compute pipeline
+		}
+
+		pipeline->run(executionState.computeScheduler, baseGroup, groupCount);
+	}
+
+private:
+	VkBuffer buffer;
+	VkDeviceSize offset;
+};
+
 struct Draw : public CommandBuffer::Command
 {
 	Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
@@ -150,27 +199,33 @@ struct Draw : public CommandBuffer::Command
 	{
 		GraphicsPipeline* pipeline = static_cast<GraphicsPipeline*>(
 			executionState.pipelines[VK_PIPELINE_BIND_POINT_GRAPHICS]);
+		sw::Renderer* renderer = executionState.renderer;
+		const sw::Context& context = pipeline->getContext();
+
+		// The pipeline state is immutable, so the renderer's copy of it, and the
+		// processor states derived from it, stay valid until another pipeline is used
+		bool pipelineChanged = (executionState.rendererPipeline != pipeline);
+
+		if(pipelineChanged)
+		{
+			renderer->setContext(context);
+			renderer->setScissor(pipeline->getScissor());
+			renderer->setViewport(pipeline->getViewport());
+			renderer->setBlendConstant(pipeline->getBlendConstants());
+
+			executionState.rendererPipeline = pipeline;
+		}
 
-		sw::Context context = pipeline->getContext();
 		for(uint32_t i = 0; i < MAX_VERTEX_INPUT_BINDINGS; i++)
 		{
 			const auto& vertexInput = executionState.vertexInputBindings[i];
 			Buffer* buffer = Cast(vertexInput.buffer);
-			context.input[i].buffer = buffer ? buffer->getOffsetPointer(vertexInput.offset + context.input[i].stride * firstVertex) : nullptr;
+			renderer->setInputBuffer(i, buffer ? buffer->getOffsetPointer(vertexInput.offset + context.input[i].stride * firstVertex) : nullptr);
 		}
 
-		executionState.renderer->setContext(context);
-		executionState.renderer->setScissor(pipeline->getScissor());
-		executionState.renderer->setViewport(pipeline->getViewport());
-		executionState.renderer->setBlendConstant(pipeline->getBlendConstants());
-
 		const uint32_t primitiveCount = pipeline->computePrimitiveCount(vertexCount);
-		const uint32_t lastInstance = firstInstance + instanceCount - 1;
-		for(uint32_t instance = firstInstance; instance <= lastInstance; instance++)
-		{
-			executionState.renderer->setInstanceID(instance);
-			executionState.renderer->draw(context.drawType, 0, primitiveCount);
-		}
+		renderer->setInstanceID(firstInstance);
+		renderer->draw(context.drawType, 0, primitiveCount, instanceCount, pipelineChanged);
 	}
 
 	uint32_t vertexCount;
@@ -286,7 +341,7 @@ private:
 	VkBuffer dstBuffer;
 	VkDeviceSize dstOffset;
 	VkDeviceSize dataSize;
-	const void* pData;
+	const void* pData;   // Copied into the command buffer
 };
 
 struct ClearColorImage : public CommandBuffer::Command
@@ -414,25 +469,55 @@ private:
 	VkPipelineStageFlags stageMask; // FIXME(b/117835459) : We currently ignore the flags and reset the event at the last stage
 };
 
-CommandBuffer::CommandBuffer(VkCommandBufferLevel pLevel) : level(pLevel)
+CommandBuffer::CommandBuffer(VkCommandBufferLevel pLevel, CommandPool* pool) : level(pLevel), pool(pool)
 {
-	// FIXME (b/119409619): replace this vector by an allocator so we can control all memory allocations
-	commands = new std::vector<std::unique_ptr<Command> >();
 }
 
 void CommandBuffer::destroy(const VkAllocationCallbacks* pAllocator)
 {
-	delete commands;
+	pool->releaseChunks(chunks);
 }
 
 void CommandBuffer::resetState()
 {
-	// FIXME (b/119409619): replace this vector by an allocator so we can control all memory allocations
-	commands->clear();
+	// Commands don't need to be destroyed, so this doesn't depend on their number
+	pool->releaseChunks(chunks);
+	chunks = nullptr;
+	chunkOffset = 0;
+	outOfMemory = false;
+
+	firstCommand = nullptr;
+	lastCommand = nullptr;
 
 	state = INITIAL;
 }
 
+void* CommandBuffer::allocate(size_t size, size_t alignment)
+{
+	ASSERT(alignment <= alignof(CommandPool::Chunk));
+
+	size_t offset = (chunkOffset + alignment - 1) & ~(alignment - 1);
+
+	if(!chunks || offset + size > chunks->size)
+	{
+		CommandPool::Chunk* chunk = pool->allocateChunk(size);
+
+		if(!chunk)
+		{
+			outOfMemory = true;
+			return nullptr;
+		}
+
+		chunk->next = chunks;
+		chunks = chunk;
+		offset = 0;
+	}
+
+	chunkOffset = offset + size;
+
+	return chunks->data() + offset;
+}
+
 VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, const VkCommandBufferInheritanceInfo* pInheritanceInfo)
 {
 	ASSERT((state != RECORDING) && (state != PENDING));
@@ -457,6 +542,13 @@ VkResult CommandBuffer::end()
 {
 	ASSERT(state == RECORDING);
 
+	if(outOfMemory)
+	{
+		state = INVALID;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
 	state = EXECUTABLE;
 
 	return VK_SUCCESS;
@@ -474,7 +566,27 @@ VkResult CommandBuffer::reset(VkCommandPoolResetFlags flags)
 template<typename T, typename... Args>
 void CommandBuffer::addCommand(Args&&... args)
 {
-	commands->push_back(std::unique_ptr<T>(new T(std::forward<Args>(args)...)));
+	static_assert(std::is_trivially_destructible<T>::value, "Commands are never destroyed");
+
+	void* memory = allocate(sizeof(T), alignof(T));
+
+	if(!memory)
+	{
+		return;   // Reported by end()
+	}
+
+	T* command = new (memory) T(std::forward<Args>(args)...);
+
+	if(lastCommand)
+	{
+		lastCommand->next = command;
+	}
+	else
+	{
+		firstCommand = command;
+	}
+
+	lastCommand = command;
 }
 
 void CommandBuffer::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkRect2D renderArea,
@@ -487,7 +599,13 @@ void CommandBuffer::beginRenderPass(VkRenderPass renderPass, VkFramebuffer frame
 		UNIMPLEMENTED();
 	}
 
-	addCommand<BeginRenderPass>(renderPass, framebuffer, renderArea, clearValueCount, clearValues);
+	VkClearValue* clearValuesCopy = static_cast<VkClearValue*>(allocate(clearValueCount * sizeof(VkClearValue), alignof(VkClearValue)));
+
+	if(clearValuesCopy)
+	{
+		memcpy(clearValuesCopy, clearValues, clearValueCount * sizeof(VkClearValue));
+		addCommand<BeginRenderPass>(renderPass, framebuffer, renderArea, clearValueCount, clearValuesCopy);
+	}
 }
 
 void CommandBuffer::nextSubpass(VkSubpassContents contents)
@@ -515,7 +633,7 @@ void CommandBuffer::setDeviceMask(uint32_t deviceMask)
 void CommandBuffer::dispatchBase(uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
                                  uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
-	UNIMPLEMENTED();
+	addCommand<Dispatch>(baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
 }
 
 void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
@@ -529,11 +647,6 @@ void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelin
 
 void CommandBuffer::bindPipeline(VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline)
 {
-	if(pipelineBindPoint != VK_PIPELINE_BIND_POINT_GRAPHICS)
-	{
-		UNIMPLEMENTED();
-	}
-
 	addCommand<PipelineBind>(pipelineBindPoint, pipeline);
 }
 
@@ -675,12 +788,12 @@ void CommandBuffer::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkInde
 
 void CommandBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
-	UNIMPLEMENTED();
+	addCommand<Dispatch>(0, 0, 0, groupCountX, groupCountY, groupCountZ);
 }
 
 void CommandBuffer::dispatchIndirect(VkBuffer buffer, VkDeviceSize offset)
 {
-	UNIMPLEMENTED();
+	addCommand<DispatchIndirect>(buffer, offset);
 }
 
 void CommandBuffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions)
@@ -750,7 +863,14 @@ void CommandBuffer::updateBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkD
 {
 	ASSERT(state == RECORDING);
 
-	addCommand<UpdateBuffer>(dstBuffer, dstOffset, dataSize, pData);
+	// The data is consumed at record time, as required by the spec
+	void* data = allocate(static_cast<size_t>(dataSize), 4);
+
+	if(data)
+	{
+		memcpy(data, pData, static_cast<size_t>(dataSize));
+		addCommand<UpdateBuffer>(dstBuffer, dstOffset, dataSize, data);
+	}
 }
 
 void CommandBuffer::fillBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size, uint32_t data)
@@ -849,7 +969,7 @@ void CommandBuffer::submit(CommandBuffer::ExecutionState& executionState)
 	// Perform recorded work
 	state = PENDING;
 
-	for(auto& command : *commands)
+	for(Command* command = firstCommand; command; command = command->next)
 	{
 		command->play(executionState);
 	}
@@ -16,12 +16,12 @@
 #define VK_COMMAND_BUFFER_HPP_
 
 #include "VkConfig.h"
+#include "VkCommandPool.hpp"
 #include "VkObject.hpp"
-#include <memory>
-#include <vector>
 
 namespace sw
 {
+	class ComputeScheduler;
 	class Renderer;
 }
 
@@ -37,7 +37,7 @@ class CommandBuffer
 public:
 	static constexpr VkSystemAllocationScope GetAllocationScope() { return VK_SYSTEM_ALLOCATION_SCOPE_OBJECT; }
 
-	CommandBuffer(VkCommandBufferLevel pLevel);
+	CommandBuffer(VkCommandBufferLevel pLevel, CommandPool* pool);
 
 	void destroy(const VkAllocationCallbacks* pAllocator);
 
@@ -122,9 +122,11 @@ public:
 	struct ExecutionState
 	{
 		sw::Renderer* renderer = nullptr;
+		sw::ComputeScheduler* computeScheduler = nullptr;
 		RenderPass* renderPass = nullptr;
 		Framebuffer* renderPassFramebuffer = nullptr;
 		Pipeline* pipelines[VK_PIPELINE_BIND_POINT_RANGE_SIZE] = {};
+		const Pipeline* rendererPipeline = nullptr;   // Pipeline whose state the renderer holds
 
 		struct VertexInputBinding
 		{
@@ -139,14 +141,20 @@ public:
 	class Command;
 private:
 	void resetState();
+	void* allocate(size_t size, size_t alignment);   // Recorded data lives until the next reset
 	template<typename T, typename... Args> void addCommand(Args&&... args);
 
 	enum State { INITIAL, RECORDING, EXECUTABLE, PENDING, INVALID };
 	State state = INITIAL;
 	VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-	// FIXME (b/119409619): replace this vector by an allocator so we can control all memory allocations
-	std::vector<std::unique_ptr<Command>>* commands;
+	CommandPool* pool;
+	CommandPool::Chunk* chunks = nullptr;   // Most recently allocated first
+	size_t chunkOffset = 0;                 // Of the free memory in the first chunk
+	bool outOfMemory = false;
+
+	Command* firstCommand = nullptr;
+	Command* lastCommand = nullptr;
 };
 
 using DispatchableCommandBuffer = DispatchableObject<CommandBuffer, VkCommandBuffer>;
@@ -15,7 +15,6 @@
 #include "VkCommandPool.hpp"
 #include "VkCommandBuffer.hpp"
 #include "VkDestroy.h"
-#include <algorithm>
 
 namespace vk
 {
@@ -36,6 +35,23 @@ void CommandPool::destroy(const VkAllocationCallbacks* pAllocator)
 
 	// FIXME (b/119409619): use an allocator here so we can control all memory allocations
 	delete commandBuffers;
+
+	freeChunks(recycledChunks);
+	recycledChunks = nullptr;
+}
+
+void CommandPool::setAllocator(const VkAllocationCallbacks* pAllocator)
+{
+	// The callbacks are copied, since they're used long after pool creation
+	if(pAllocator)
+	{
+		allocationCallbacks = *pAllocator;
+		this->pAllocator = &allocationCallbacks;
+	}
+	else
+	{
+		this->pAllocator = nullptr;
+	}
 }
 
 size_t CommandPool::ComputeRequiredAllocationSize(const VkCommandPoolCreateInfo* pCreateInfo)
@@ -47,7 +63,7 @@ VkResult CommandPool::allocateCommandBuffers(VkCommandBufferLevel level, uint32_
 {
 	for(uint32_t i = 0; i < commandBufferCount; i++)
 	{
-		DispatchableCommandBuffer* commandBuffer = new (DEVICE_MEMORY) DispatchableCommandBuffer(level);
+		DispatchableCommandBuffer* commandBuffer = new (DEVICE_MEMORY) DispatchableCommandBuffer(level, this);
 		if(commandBuffer)
 		{
 			pCommandBuffers[i] = *commandBuffer;
@@ -94,14 +110,82 @@ VkResult CommandPool::reset(VkCommandPoolResetFlags flags)
 	// "Resetting a command pool recycles all of the
 	//  resources from all of the command buffers allocated
 	//  from the command pool back to the command pool."
-	commandBuffers->clear();
+	// The command buffers returned their chunks when they got reset, and
+	// remain allocated from this pool.
+	if(flags & VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT)
+	{
+		trim(0);
+	}
 
 	return VK_SUCCESS;
 }
 
 void CommandPool::trim(VkCommandPoolTrimFlags flags)
 {
-	// TODO (b/119827933): Optimize memory usage here
+	// Chunks still in use by command buffers are kept
+	freeChunks(recycledChunks);
+	recycledChunks = nullptr;
+}
+
+CommandPool::Chunk* CommandPool::allocateChunk(size_t size)
+{
+	if(size <= CHUNK_SIZE && recycledChunks)
+	{
+		Chunk* chunk = recycledChunks;
+		recycledChunks = chunk->next;
+		chunk->next = nullptr;
+
+		return chunk;
+	}
+
+	// Commands with large payloads get a dedicated chunk
+	if(size < CHUNK_SIZE)
+	{
+		size = CHUNK_SIZE;
+	}
+
+	void* memory = vk::allocate(sizeof(Chunk) + size, alignof(Chunk), pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+	if(!memory)
+	{
+		return nullptr;
+	}
+
+	Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+	chunk->next = nullptr;
+	chunk->size = size;
+
+	return chunk;
+}
+
+void CommandPool::releaseChunks(Chunk* chunks)
+{
+	while(chunks)
+	{
+		Chunk* next = chunks->next;
+
+		if(chunks->size == CHUNK_SIZE)
+		{
+			chunks->next = recycledChunks;
+			recycledChunks = chunks;
+		}
+		else
+		{
+			vk::deallocate(chunks, pAllocator);
+		}
+
+		chunks = next;
+	}
+}
+
+void CommandPool::freeChunks(Chunk* chunks)
+{
+	while(chunks)
+	{
+		Chunk* next = chunks->next;
+		vk::deallocate(chunks, pAllocator);
+		chunks = next;
+	}
 }
 
 } // namespace vk
@@ -30,13 +30,36 @@ public:
 
 	static size_t ComputeRequiredAllocationSize(const VkCommandPoolCreateInfo* pCreateInfo);
 
+	void setAllocator(const VkAllocationCallbacks* pAllocator);
+
 	VkResult allocateCommandBuffers(VkCommandBufferLevel level, uint32_t commandBufferCount, VkCommandBuffer* pCommandBuffers);
 	void freeCommandBuffers(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers);
 	VkResult reset(VkCommandPoolResetFlags flags);
 	void trim(VkCommandPoolTrimFlags flags);
 
+	// Commands are recorded into chunks of memory owned by the pool. Command buffers
+	// return their chunks when they get reset, and later recordings reuse them.
+	struct alignas(16) Chunk
+	{
+		Chunk* next;
+		size_t size;   // Bytes available after the header
+
+		uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+	};
+
+	Chunk* allocateChunk(size_t size);   // At least the requested size, or nullptr
+	void releaseChunks(Chunk* chunks);
+
 private:
+	static const size_t CHUNK_SIZE = 64 * 1024 - sizeof(Chunk);
+
+	void freeChunks(Chunk* chunks);
+
 	std::set<VkCommandBuffer>* commandBuffers;
+	Chunk* recycledChunks = nullptr;
+
+	VkAllocationCallbacks allocationCallbacks;
+	const VkAllocationCallbacks* pAllocator = nullptr;   // Null, or pointing to allocationCallbacks
 };
 
 static inline CommandPool* Cast(VkCommandPool object)
@@ -16,8 +16,10 @@
 
 #include "VkConfig.h"
 #include "VkDebug.hpp"
+#include "VkFence.hpp"
 #include "VkQueue.hpp"
 
+#include <chrono>
 #include <new> // Must #include this to use "placement new"
 
 namespace vk
@@ -84,9 +86,53 @@ VkQueue Device::getQueue(uint32_t queueFamilyIndex, uint32_t queueIndex) const
 	return queues[queueIndex];
 }
 
-void Device::waitForFences(uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t timeout)
+VkResult Device::waitForFences(uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t timeout)
 {
-	// FIXME(b/117835459) : noop
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point now = Clock::now();
+	Clock::time_point deadline = Clock::time_point::max();
+
+	// Timeouts which don't fit in a time point are infinite
+	if(timeout < static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count()))
+	{
+		deadline = now + std::chrono::nanoseconds(timeout);
+	}
+
+	if(waitAll)
+	{
+		for(uint32_t i = 0; i < fenceCount; i++)
+		{
+			if(Cast(pFences[i])->wait(deadline) == VK_TIMEOUT)
+			{
+				return VK_TIMEOUT;
+			}
+		}
+
+		return VK_SUCCESS;
+	}
+
+	// Fences can be signaled by different queues, so wait on each in short slices
+	while(true)
+	{
+		for(uint32_t i = 0; i < fenceCount; i++)
+		{
+			if(Cast(pFences[i])->getStatus() == VK_SUCCESS)
+			{
+				return VK_SUCCESS;
+			}
+		}
+
+		now = Clock::now();
+
+		if(now >= deadline)
+		{
+			return VK_TIMEOUT;
+		}
+
+		Clock::time_point slice = now + std::chrono::milliseconds(1);
+		Cast(pFences[0])->wait((slice < deadline) ? slice : deadline);
+	}
 }
 
 void Device::waitIdle()
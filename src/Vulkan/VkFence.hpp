@@ -16,20 +16,34 @@
 #define VK_FENCE_HPP_
 
 #include "VkObject.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 namespace vk
 {
 
+// Fences are signaled by the queue's submission thread, once the work
+// submitted before them has completed.
 class Fence : public Object<Fence, VkFence>
 {
 public:
 	Fence(const VkFenceCreateInfo* pCreateInfo, void* mem) :
 		status((pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) ? VK_SUCCESS : VK_NOT_READY)
 	{
+		// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+		mutex = new std::mutex();
+		condition = new std::condition_variable();
 	}
 
 	~Fence() = delete;
 
+	void destroy(const VkAllocationCallbacks* pAllocator)
+	{
+		delete mutex;
+		delete condition;
+	}
+
 	static size_t ComputeRequiredAllocationSize(const VkFenceCreateInfo* pCreateInfo)
 	{
 		return 0;
@@ -37,21 +51,35 @@ public:
 
 	void signal()
 	{
+		std::lock_guard<std::mutex> lock(*mutex);
 		status = VK_SUCCESS;
+		condition->notify_all();
 	}
 
 	void reset()
 	{
+		std::lock_guard<std::mutex> lock(*mutex);
 		status = VK_NOT_READY;
 	}
 
 	VkResult getStatus() const
 	{
+		std::lock_guard<std::mutex> lock(*mutex);
 		return status;
 	}
 
+	// Returns VK_TIMEOUT if the fence isn't signaled by the deadline
+	VkResult wait(const std::chrono::steady_clock::time_point& deadline) const
+	{
+		std::unique_lock<std::mutex> lock(*mutex);
+		condition->wait_until(lock, deadline, [this] { return status == VK_SUCCESS; });
+		return (status == VK_SUCCESS) ? VK_SUCCESS : VK_TIMEOUT;
+	}
+
 private:
 	VkResult status = VK_NOT_READY;
+	std::mutex* mutex;
+	std::condition_variable* condition;
 };
 
 static inline Fence* Cast(VkFence object)
@@ -12,8 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <Pipeline/ComputeProgram.hpp>
 #include <Pipeline/SpirvShader.hpp>
 #include "VkPipeline.hpp"
+#include "VkPipelineCache.hpp"
 #include "VkShaderModule.hpp"
 
 namespace
@@ -371,8 +373,8 @@ GraphicsPipeline::GraphicsPipeline(const VkGraphicsPipelineCreateInfo* pCreateIn
 
 void GraphicsPipeline::destroyPipeline(const VkAllocationCallbacks* pAllocator)
 {
-	delete vertexShader;
-	delete fragmentShader;
+	vertexShader.reset();
+	fragmentShader.reset();
 }
 
 size_t GraphicsPipeline::ComputeRequiredAllocationSize(const VkGraphicsPipelineCreateInfo* pCreateInfo)
@@ -380,7 +382,7 @@ size_t GraphicsPipeline::ComputeRequiredAllocationSize(const VkGraphicsPipelineC
 	return 0;
 }
 
-void GraphicsPipeline::compileShaders(const VkAllocationCallbacks* pAllocator, const VkGraphicsPipelineCreateInfo* pCreateInfo)
+void GraphicsPipeline::compileShaders(const VkGraphicsPipelineCreateInfo* pCreateInfo, PipelineCache* pipelineCache)
 {
 	for (auto pStage = pCreateInfo->pStages; pStage != pCreateInfo->pStages + pCreateInfo->stageCount; pStage++) {
 		auto module = Cast(pStage->module);
@@ -391,7 +393,7 @@ void GraphicsPipeline::compileShaders(const VkAllocationCallbacks* pAllocator, c
 
 		// TODO: pass in additional information here:
 		// - any NOS from pCreateInfo which we'll actually need
-		auto spirvShader = new sw::SpirvShader{code};
+		auto spirvShader = pipelineCache ? pipelineCache->getOrCreateShader(code) : std::make_shared<sw::SpirvShader>(code);
 
 		switch (pStage->stage) {
 			case VK_SHADER_STAGE_VERTEX_BIT:
@@ -457,6 +459,8 @@ ComputePipeline::ComputePipeline(const VkComputePipelineCreateInfo* pCreateInfo,
 
 void ComputePipeline::destroyPipeline(const VkAllocationCallbacks* pAllocator)
 {
+	delete routine;
+	shader.reset();
 }
 
 size_t ComputePipeline::ComputeRequiredAllocationSize(const VkComputePipelineCreateInfo* pCreateInfo)
@@ -464,4 +468,26 @@ size_t ComputePipeline::ComputeRequiredAllocationSize(const VkComputePipelineCre
 	return 0;
 }
 
+void ComputePipeline::compileShaders(const VkComputePipelineCreateInfo* pCreateInfo, PipelineCache* pipelineCache)
+{
+	auto module = Cast(pCreateInfo->stage.module);
+	auto code = module->getCode();
+
+	shader = pipelineCache ? pipelineCache->getOrCreateShader(code) : std::make_shared<sw::SpirvShader>(code);
+
+	// TODO: generate the workgroup routine once SpirvShader can translate instructions.
+	// It only depends on the shader, so it will be generated once for the pipeline.
+}
+
+void ComputePipeline::run(sw::ComputeScheduler* scheduler, const uint32_t baseGroup[3], const uint32_t groupCount[3]) const
+{
+	if(!routine)
+	{
+		UNIMPLEMENTED("SPIR-V compute shaders");
+		return;
+	}
+
+	scheduler->run(routine, baseGroup, groupCount);
+}
+
 } // namespace vk
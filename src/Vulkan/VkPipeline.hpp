@@ -17,12 +17,19 @@
 
 #include "VkObject.hpp"
 #include "Device/Renderer.hpp"
+#include <memory>
 
-namespace sw { class SpirvShader; }
+namespace sw
+{
+	class ComputeScheduler;
+	class SpirvShader;
+}
 
 namespace vk
 {
 
+class PipelineCache;
+
 class Pipeline
 {
 public:
@@ -58,7 +65,8 @@ public:
 
 	static size_t ComputeRequiredAllocationSize(const VkGraphicsPipelineCreateInfo* pCreateInfo);
 
-	void compileShaders(const VkAllocationCallbacks* pAllocator, const VkGraphicsPipelineCreateInfo* pCreateInfo);
+	// Doesn't allocate through the application's callbacks, so it may run on any thread
+	void compileShaders(const VkGraphicsPipelineCreateInfo* pCreateInfo, PipelineCache* pipelineCache);
 
 	uint32_t computePrimitiveCount(uint32_t vertexCount) const;
 	const sw::Context& getContext() const;
@@ -67,8 +75,9 @@ public:
 	const sw::Color<float>& getBlendConstants() const;
 
 private:
-	sw::SpirvShader *vertexShader = nullptr;
-	sw::SpirvShader *fragmentShader = nullptr;
+	// Shared with the pipeline cache and other pipelines using the same code
+	std::shared_ptr<sw::SpirvShader> vertexShader;
+	std::shared_ptr<sw::SpirvShader> fragmentShader;
 
 	rr::Routine* vertexRoutine;
 	rr::Routine* fragmentRoutine;
@@ -94,6 +103,15 @@ public:
 #endif
 
 	static size_t ComputeRequiredAllocationSize(const VkComputePipelineCreateInfo* pCreateInfo);
+
+	void compileShaders(const VkComputePipelineCreateInfo* pCreateInfo, PipelineCache* pipelineCache);
+
+	// Returns once all workgroups have completed
+	void run(sw::ComputeScheduler* scheduler, const uint32_t baseGroup[3], const uint32_t groupCount[3]) const;
+
+private:
+	std::shared_ptr<sw::SpirvShader> shader;   // Shared with the pipeline cache
+	rr::Routine* routine = nullptr;
 };
 
 static inline Pipeline* Cast(VkPipeline object)
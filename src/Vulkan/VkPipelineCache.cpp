@@ -0,0 +1,247 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VkPipelineCache.hpp"
+#include "VkConfig.h"
+#include <Pipeline/SpirvShader.hpp>
+#include <System/Hash.hpp>
+#include <cstring>
+
+namespace
+{
+
+// Follows the VkPipelineCacheHeaderVersionOne layout from the Vulkan spec
+struct CacheHeader
+{
+	uint32_t headerSize;
+	uint32_t headerVersion;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+// Each entry is stored as this record, followed by its SPIR-V words
+struct EntryRecord
+{
+	uint64_t hash;
+	uint64_t wordCount;
+};
+
+void initializeHeader(CacheHeader& header)
+{
+	header.headerSize = sizeof(CacheHeader);
+	header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+	header.vendorID = vk::VENDOR_ID;
+	header.deviceID = vk::DEVICE_ID;
+	memset(header.pipelineCacheUUID, 0, VK_UUID_SIZE);
+	memcpy(header.pipelineCacheUUID, SWIFTSHADER_UUID, strlen(SWIFTSHADER_UUID));
+}
+
+uint64_t hashCode(const std::vector<uint32_t>& code)
+{
+	return sw::hash64(code.data(), code.size() * sizeof(uint32_t));
+}
+
+} // anonymous namespace
+
+namespace vk
+{
+
+PipelineCache::PipelineCache(const VkPipelineCacheCreateInfo* pCreateInfo, void* mem)
+{
+	// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+	entries = new std::map<uint64_t, Entry>();
+	mutex = new std::mutex();
+
+	if(pCreateInfo->initialDataSize > 0)
+	{
+		loadInitialData(pCreateInfo->pInitialData, pCreateInfo->initialDataSize);
+	}
+}
+
+void PipelineCache::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	// Pipelines keep their own references to the shaders they use
+	delete entries;
+	delete mutex;
+}
+
+size_t PipelineCache::ComputeRequiredAllocationSize(const VkPipelineCacheCreateInfo* pCreateInfo)
+{
+	return 0;
+}
+
+void PipelineCache::loadInitialData(const void* data, size_t size)
+{
+	// Data from a different driver or device is ignored, as required by the spec
+	CacheHeader expected;
+	initializeHeader(expected);
+
+	if(size < sizeof(CacheHeader) || memcmp(data, &expected, sizeof(CacheHeader)) != 0)
+	{
+		return;
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data) + sizeof(CacheHeader);
+	size_t remaining = size - sizeof(CacheHeader);
+
+	while(remaining >= sizeof(EntryRecord))
+	{
+		EntryRecord record;
+		memcpy(&record, bytes, sizeof(EntryRecord));
+		bytes += sizeof(EntryRecord);
+		remaining -= sizeof(EntryRecord);
+
+		if(record.wordCount == 0 || record.wordCount > remaining / sizeof(uint32_t))
+		{
+			return;   // Truncated or corrupt
+		}
+
+		std::vector<uint32_t> code(static_cast<size_t>(record.wordCount));
+		memcpy(code.data(), bytes, code.size() * sizeof(uint32_t));
+		bytes += code.size() * sizeof(uint32_t);
+		remaining -= code.size() * sizeof(uint32_t);
+
+		if(hashCode(code) != record.hash)
+		{
+			return;
+		}
+
+		(*entries)[record.hash].code = std::move(code);
+	}
+}
+
+VkResult PipelineCache::getData(size_t* pDataSize, void* pData)
+{
+	std::lock_guard<std::mutex> lock(*mutex);
+
+	if(!pData)
+	{
+		size_t size = sizeof(CacheHeader);
+
+		for(auto& entry : *entries)
+		{
+			size += sizeof(EntryRecord) + entry.second.code.size() * sizeof(uint32_t);
+		}
+
+		*pDataSize = size;
+		return VK_SUCCESS;
+	}
+
+	if(*pDataSize < sizeof(CacheHeader))
+	{
+		*pDataSize = 0;
+		return VK_INCOMPLETE;
+	}
+
+	CacheHeader header;
+	initializeHeader(header);
+
+	uint8_t* bytes = static_cast<uint8_t*>(pData);
+	memcpy(bytes, &header, sizeof(CacheHeader));
+	size_t size = sizeof(CacheHeader);
+
+	// Only whole entries are written, so partial data remains valid initial data
+	for(auto& entry : *entries)
+	{
+		size_t codeSize = entry.second.code.size() * sizeof(uint32_t);
+
+		if(size + sizeof(EntryRecord) + codeSize > *pDataSize)
+		{
+			*pDataSize = size;
+			return VK_INCOMPLETE;
+		}
+
+		EntryRecord record = { entry.first, entry.second.code.size() };
+		memcpy(bytes + size, &record, sizeof(EntryRecord));
+		memcpy(bytes + size + sizeof(EntryRecord), entry.second.code.data(), codeSize);
+		size += sizeof(EntryRecord) + codeSize;
+	}
+
+	*pDataSize = size;
+	return VK_SUCCESS;
+}
+
+VkResult PipelineCache::merge(uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches)
+{
+	for(uint32_t i = 0; i < srcCacheCount; i++)
+	{
+		// Source caches can be merged into other caches concurrently, so only one lock is held
+		// at a time. Holding both could deadlock against a merge in the opposite direction.
+		std::map<uint64_t, Entry> srcEntries;
+
+		{
+			PipelineCache* srcCache = Cast(pSrcCaches[i]);
+			std::lock_guard<std::mutex> srcLock(*srcCache->mutex);
+			srcEntries = *srcCache->entries;
+		}
+
+		std::lock_guard<std::mutex> lock(*mutex);
+
+		for(auto& entry : srcEntries)
+		{
+			Entry& dstEntry = (*entries)[entry.first];
+
+			if(dstEntry.code.empty())
+			{
+				dstEntry = entry.second;
+			}
+			else if(!dstEntry.shader)
+			{
+				dstEntry.shader = entry.second.shader;
+			}
+		}
+	}
+
+	return VK_SUCCESS;
+}
+
+std::shared_ptr<sw::SpirvShader> PipelineCache::getOrCreateShader(const std::vector<uint32_t>& code)
+{
+	uint64_t hash = hashCode(code);
+
+	{
+		std::lock_guard<std::mutex> lock(*mutex);
+		auto it = entries->find(hash);
+
+		if(it != entries->end() && it->second.code == code && it->second.shader)
+		{
+			return it->second.shader;
+		}
+	}
+
+	// Parse outside of the lock, so other pipelines can be created concurrently
+	auto shader = std::make_shared<sw::SpirvShader>(code);
+
+	std::lock_guard<std::mutex> lock(*mutex);
+	Entry& entry = (*entries)[hash];
+
+	if(entry.code.empty())
+	{
+		entry.code = code;
+	}
+	else if(entry.code != code)
+	{
+		return shader;   // Hash collision, keep the existing entry
+	}
+
+	if(!entry.shader)
+	{
+		entry.shader = shader;
+	}
+
+	return entry.shader;
+}
+
+} // namespace vk
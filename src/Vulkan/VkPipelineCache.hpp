@@ -16,25 +16,46 @@
 #define VK_PIPELINE_CACHE_HPP_
 
 #include "VkObject.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sw { class SpirvShader; }
 
 namespace vk
 {
 
+// Caches shader modules by the hash of their SPIR-V code. Parsed shaders are
+// shared between pipelines, so their routines are only generated once, and the
+// code is serialized by getData() so applications can restore the cache later.
 class PipelineCache : public Object<PipelineCache, VkPipelineCache>
 {
 public:
-	PipelineCache(const VkPipelineCacheCreateInfo* pCreateInfo, void* mem)
-	{
-	}
-
+	PipelineCache(const VkPipelineCacheCreateInfo* pCreateInfo, void* mem);
 	~PipelineCache() = delete;
+	void destroy(const VkAllocationCallbacks* pAllocator);
 
-	static size_t ComputeRequiredAllocationSize(const VkPipelineCacheCreateInfo* pCreateInfo)
-	{
-		return 0;
-	}
+	static size_t ComputeRequiredAllocationSize(const VkPipelineCacheCreateInfo* pCreateInfo);
+
+	VkResult getData(size_t* pDataSize, void* pData);
+	VkResult merge(uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches);
+
+	// Returns the parsed shader for the code, parsing it on first use
+	std::shared_ptr<sw::SpirvShader> getOrCreateShader(const std::vector<uint32_t>& code);
 
 private:
+	struct Entry
+	{
+		std::vector<uint32_t> code;
+		std::shared_ptr<sw::SpirvShader> shader;   // Null until a pipeline uses the entry
+	};
+
+	void loadInitialData(const void* data, size_t size);
+
+	// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+	std::map<uint64_t, Entry>* entries;
+	std::mutex* mutex;   // Pipeline caches are internally synchronized
 };
 
 static inline PipelineCache* Cast(VkPipelineCache object)
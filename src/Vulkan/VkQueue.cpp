@@ -17,6 +17,8 @@
 #include "VkQueue.hpp"
 #include "VkSemaphore.hpp"
 #include "Device/Renderer.hpp"
+#include "Pipeline/ComputeProgram.hpp"
+#include "System/CPUID.hpp"
 
 namespace vk
 {
@@ -25,52 +27,161 @@ Queue::Queue(uint32_t pFamilyIndex, float pPriority) : familyIndex(pFamilyIndex)
 {
 	context = new sw::Context();
 	renderer = new sw::Renderer(context, sw::OpenGL, true);
+	computeScheduler = new sw::ComputeScheduler(sw::CPUID::coreCount());
+
+	mutex = new std::mutex();
+	taskAvailable = new std::condition_variable();
+	idle = new std::condition_variable();
+	tasks = new std::deque<Task>();
+	thread = new std::thread(&Queue::run, this);
 }
 
 void Queue::destroy()
 {
+	{
+		std::lock_guard<std::mutex> lock(*mutex);
+		exit = true;
+	}
+
+	taskAvailable->notify_one();
+	thread->join();
+
+	delete thread;
+	delete tasks;
+	delete idle;
+	delete taskAvailable;
+	delete mutex;
+
 	delete context;
 	delete renderer;
+	delete computeScheduler;
 }
 
 void Queue::submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence)
 {
+	std::vector<Task> submissions(submitCount);
+
 	for(uint32_t i = 0; i < submitCount; i++)
 	{
 		auto& submitInfo = pSubmits[i];
-		for(uint32_t j = 0; j < submitInfo.waitSemaphoreCount; j++)
+		Task& task = submissions[i];
+
+		task.waitSemaphores.assign(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+		task.waitDstStageMask.assign(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+		task.commandBuffers.assign(submitInfo.pCommandBuffers, submitInfo.pCommandBuffers + submitInfo.commandBufferCount);
+		task.signalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	}
+
+	if(fence != VK_NULL_HANDLE)
+	{
+		// Without any batches, the fence still signals once all prior work has completed
+		if(submissions.empty())
 		{
-			vk::Cast(submitInfo.pWaitSemaphores[j])->wait(submitInfo.pWaitDstStageMask[j]);
+			submissions.resize(1);
 		}
 
+		submissions.back().fence = fence;
+	}
+
+	if(submissions.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(*mutex);
+
+		for(auto& task : submissions)
 		{
-			CommandBuffer::ExecutionState executionState;
-			executionState.renderer = renderer;
-			for(uint32_t j = 0; j < submitInfo.commandBufferCount; j++)
+			tasks->push_back(std::move(task));
+		}
+
+		pending += static_cast<uint32_t>(submissions.size());
+	}
+
+	taskAvailable->notify_one();
+}
+
+void Queue::waitIdle()
+{
+	// equivalent to submitting a fence to a queue and waiting
+	// with an infinite timeout for that fence to signal
+	std::unique_lock<std::mutex> lock(*mutex);
+	idle->wait(lock, [this] { return pending == 0; });
+}
+
+void Queue::run()
+{
+	while(true)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(*mutex);
+			taskAvailable->wait(lock, [this] { return !tasks->empty() || exit; });
+
+			if(tasks->empty())
 			{
-				vk::Cast(submitInfo.pCommandBuffers[j])->submit(executionState);
+				return;   // Only exits once all submitted work is done
 			}
+
+			task = std::move(tasks->front());
+			tasks->pop_front();
+		}
+
+		execute(task);
+
+		std::unique_lock<std::mutex> lock(*mutex);
+
+		if(tasks->empty())
+		{
+			// Make sure waitIdle() also covers the rendering still in flight
+			lock.unlock();
+			renderer->synchronize();
+			lock.lock();
 		}
 
-		for(uint32_t j = 0; j < submitInfo.signalSemaphoreCount; j++)
+		if(--pending == 0)
 		{
-			vk::Cast(submitInfo.pSignalSemaphores[j])->signal();
+			idle->notify_all();
 		}
 	}
+}
 
-	// FIXME (b/117835459): signal the fence only once the work is completed
-	if(fence != VK_NULL_HANDLE)
+void Queue::execute(const Task& task)
+{
+	for(size_t i = 0; i < task.waitSemaphores.size(); i++)
 	{
-		vk::Cast(fence)->signal();
+		vk::Cast(task.waitSemaphores[i])->wait(task.waitDstStageMask[i]);
 	}
-}
 
-void Queue::waitIdle()
-{
-	// equivalent to submitting a fence to a queue and waiting
-	// with an infinite timeout for that fence to signal
-
-	// FIXME (b/117835459): implement once we have working fences
+	{
+		CommandBuffer::ExecutionState executionState;
+		executionState.renderer = renderer;
+		executionState.computeScheduler = computeScheduler;
+		for(auto commandBuffer : task.commandBuffers)
+		{
+			vk::Cast(commandBuffer)->submit(executionState);
+		}
+	}
+
+	if(task.signalSemaphores.empty() && (task.fence == VK_NULL_HANDLE))
+	{
+		return;
+	}
+
+	// Signal only once the work is completed
+	renderer->synchronize();
+
+	for(auto semaphore : task.signalSemaphores)
+	{
+		vk::Cast(semaphore)->signal();
+	}
+
+	if(task.fence != VK_NULL_HANDLE)
+	{
+		vk::Cast(task.fence)->signal();
+	}
 }
 
-} // namespace vk
\ No newline at end of file
+} // namespace vk
@@ -17,9 +17,15 @@
 
 #include "VkObject.hpp"
 #include <vulkan/vk_icd.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace sw
 {
+	class ComputeScheduler;
 	class Context;
 	class Renderer;
 }
@@ -40,13 +46,38 @@ public:
 		return reinterpret_cast<VkQueue>(this);
 	}
 
-	void destroy();
+	void destroy();   // Finishes all submitted work
 	void submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence);
 	void waitIdle();
 
 private:
+	// Copy of a VkSubmitInfo, since the application may free it as soon as vkQueueSubmit returns
+	struct Task
+	{
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitDstStageMask;
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> signalSemaphores;
+		VkFence fence = VK_NULL_HANDLE;   // Signaled once this and all prior work has completed
+	};
+
+	// Submissions are executed in order on a dedicated thread, so the application
+	// can record new command buffers while the previous ones are being rendered.
+	void run();
+	void execute(const Task& task);
+
+	// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+	std::thread* thread = nullptr;
+	std::mutex* mutex = nullptr;
+	std::condition_variable* taskAvailable = nullptr;
+	std::condition_variable* idle = nullptr;
+	std::deque<Task>* tasks = nullptr;
+	uint32_t pending = 0;   // Tasks submitted but not yet completed
+	bool exit = false;
+
 	sw::Context* context = nullptr;
 	sw::Renderer* renderer = nullptr;
+	sw::ComputeScheduler* computeScheduler = nullptr;
 	uint32_t familyIndex = 0;
 	float    priority = 0.0f;
 };
@@ -16,17 +16,32 @@
 #define VK_SEMAPHORE_HPP_
 
 #include "VkObject.hpp"
+#include <condition_variable>
+#include <mutex>
 
 namespace vk
 {
 
+// Binary semaphore. Waits are performed by the queue's submission thread,
+// and consume the signal.
 class Semaphore : public Object<Semaphore, VkSemaphore>
 {
 public:
-	Semaphore(const VkSemaphoreCreateInfo* pCreateInfo, void* mem) {}
+	Semaphore(const VkSemaphoreCreateInfo* pCreateInfo, void* mem)
+	{
+		// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+		mutex = new std::mutex();
+		condition = new std::condition_variable();
+	}
 
 	~Semaphore() = delete;
 
+	void destroy(const VkAllocationCallbacks* pAllocator)
+	{
+		delete mutex;
+		delete condition;
+	}
+
 	static size_t ComputeRequiredAllocationSize(const VkSemaphoreCreateInfo* pCreateInfo)
 	{
 		return 0;
@@ -34,22 +49,29 @@ public:
 
 	void wait()
 	{
-		// Semaphores are noop for now
+		std::unique_lock<std::mutex> lock(*mutex);
+		condition->wait(lock, [this] { return signaled; });
+		signaled = false;
 	}
 
 	void wait(const VkPipelineStageFlags& flag)
 	{
-		// VkPipelineStageFlags is the pipeline stage at which the semaphore wait will occur
-
-		// Semaphores are noop for now
+		// VkPipelineStageFlags is the pipeline stage at which the semaphore wait will occur.
+		// Submissions are executed in order, so waiting before any of the work is sufficient.
+		wait();
 	}
 
 	void signal()
 	{
-		// Semaphores are noop for now
+		std::lock_guard<std::mutex> lock(*mutex);
+		signaled = true;
+		condition->notify_all();
 	}
 
 private:
+	bool signaled = false;
+	std::mutex* mutex;
+	std::condition_variable* condition;
 };
 
 static inline Semaphore* Cast(VkSemaphore object)
@@ -40,10 +40,15 @@
 #include "VkSemaphore.hpp"
 #include "VkShaderModule.hpp"
 #include "VkRenderPass.hpp"
+#include "System/CPUID.hpp"
+#include "System/Thread.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
 
 extern "C"
 {
@@ -691,9 +696,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkWaitForFences(VkDevice device, uint32_t fenceCo
 	TRACE("(VkDevice device = 0x%X, uint32_t fenceCount = %d, const VkFence* pFences = 0x%X, VkBool32 waitAll = %d, uint64_t timeout = %d)",
 		device, fenceCount, pFences, waitAll, timeout);
 
-	vk::Cast(device)->waitForFences(fenceCount, pFences, waitAll, timeout);
-
-	return VK_SUCCESS;
+	return vk::Cast(device)->waitForFences(fenceCount, pFences, waitAll, timeout);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateSemaphore(VkDevice device, const VkSemaphoreCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSemaphore* pSemaphore)
@@ -930,16 +933,18 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineCache(VkDevice device, VkPipelineCac
 
 VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache, size_t* pDataSize, void* pData)
 {
-	TRACE("()");
-	UNIMPLEMENTED();
-	return VK_SUCCESS;
+	TRACE("(VkDevice device = 0x%X, VkPipelineCache pipelineCache = 0x%X, size_t* pDataSize = 0x%X, void* pData = 0x%X)",
+	      device, pipelineCache, pDataSize, pData);
+
+	return vk::Cast(pipelineCache)->getData(pDataSize, pData);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkMergePipelineCaches(VkDevice device, VkPipelineCache dstCache, uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches)
 {
-	TRACE("()");
-	UNIMPLEMENTED();
-	return VK_SUCCESS;
+	TRACE("(VkDevice device = 0x%X, VkPipelineCache dstCache = 0x%X, uint32_t srcCacheCount = %d, const VkPipelineCache* pSrcCaches = 0x%X)",
+	      device, dstCache, srcCacheCount, pSrcCaches);
+
+	return vk::Cast(dstCache)->merge(srcCacheCount, pSrcCaches);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
@@ -947,9 +952,8 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice device, VkPipe
 	TRACE("(VkDevice device = 0x%X, VkPipelineCache pipelineCache = 0x%X, uint32_t createInfoCount = %d, const VkGraphicsPipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator = 0x%X, VkPipeline* pPipelines = 0x%X)",
 		    device, pipelineCache, createInfoCount, pCreateInfos, pAllocator, pPipelines);
 
-	// TODO (b/123588002): Optimize based on pipelineCache.
-
 	VkResult errorResult = VK_SUCCESS;
+	std::vector<uint32_t> created;
 	for(uint32_t i = 0; i < createInfoCount; i++)
 	{
 		VkResult result = vk::GraphicsPipeline::Create(pAllocator, &pCreateInfos[i], &pPipelines[i]);
@@ -968,10 +972,41 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice device, VkPipe
 		}
 		else
 		{
-			static_cast<vk::GraphicsPipeline*>(vk::Cast(pPipelines[i]))->compileShaders(pAllocator, &pCreateInfos[i]);
+			created.push_back(i);
 		}
 	}
 
+	// The pipeline objects are created above and compiling their shaders doesn't allocate through
+	// pAllocator, so the allocation callbacks are only called from this thread. Parsing the shaders
+	// is independent for each pipeline, so large batches are spread over multiple threads. Each
+	// thread gets several pipelines, so that starting it doesn't outweigh the work it takes over.
+	const size_t pipelinesPerThread = 4;
+
+	std::atomic<size_t> next(0);
+	auto compile = [&]()
+	{
+		for(size_t j = next++; j < created.size(); j = next++)
+		{
+			uint32_t i = created[j];
+			static_cast<vk::GraphicsPipeline*>(vk::Cast(pPipelines[i]))->compileShaders(&pCreateInfos[i], vk::Cast(pipelineCache));
+		}
+	};
+
+	using Compile = decltype(compile);
+	size_t threadCount = std::min<size_t>(created.size() / pipelinesPerThread, sw::CPUID::coreCount());
+	std::vector<std::unique_ptr<sw::Thread>> threads;
+	for(size_t t = 1; t < threadCount; t++)
+	{
+		threads.emplace_back(new sw::Thread([](void *parameters) { (*static_cast<Compile*>(parameters))(); }, &compile));
+	}
+
+	compile();
+
+	for(auto& thread : threads)
+	{
+		thread->join();
+	}
+
 	return errorResult;
 }
 
@@ -980,8 +1015,6 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(VkDevice device, VkPipel
 	TRACE("(VkDevice device = 0x%X, VkPipelineCache pipelineCache = 0x%X, uint32_t createInfoCount = %d, const VkComputePipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator = 0x%X, VkPipeline* pPipelines = 0x%X)",
 		device, pipelineCache, createInfoCount, pCreateInfos, pAllocator, pPipelines);
 
-	// TODO (b/123588002): Optimize based on pipelineCache.
-
 	VkResult errorResult = VK_SUCCESS;
 	for(uint32_t i = 0; i < createInfoCount; i++)
 	{
@@ -999,6 +1032,10 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(VkDevice device, VkPipel
 			pPipelines[i] = VK_NULL_HANDLE;
 			errorResult = result;
 		}
+		else
+		{
+			static_cast<vk::ComputePipeline*>(vk::Cast(pPipelines[i]))->compileShaders(&pCreateInfos[i], vk::Cast(pipelineCache));
+		}
 	}
 
 	return errorResult;
@@ -1196,7 +1233,15 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(VkDevice device, const VkComm
 		UNIMPLEMENTED();
 	}
 
-	return vk::CommandPool::Create(pAllocator, pCreateInfo, pCommandPool);
+	VkResult result = vk::CommandPool::Create(pAllocator, pCreateInfo, pCommandPool);
+
+	if(result == VK_SUCCESS)
+	{
+		// Command buffers allocate their memory from the pool while recording
+		vk::Cast(*pCommandPool)->setAllocator(pAllocator);
+	}
+
+	return result;
 }
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice device, VkCommandPool commandPool, const VkAllocationCallbacks* pAllocator)
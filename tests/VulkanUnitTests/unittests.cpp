@@ -22,6 +22,7 @@
 #include <vulkan/vk_icd.h>
 
 #include <cstring>
+#include <vector>
 
 typedef PFN_vkVoidFunction(__stdcall *vk_icdGetInstanceProcAddrPtr)(VkInstance, const char*);
 
@@ -118,3 +119,202 @@ TEST_F(SwiftShaderVulkanTest, Version)
 
 	EXPECT_EQ(strncmp(physicalDeviceProperties.deviceName, "SwiftShader Device", VK_MAX_PHYSICAL_DEVICE_NAME_SIZE), 0);
 }
+
+TEST_F(SwiftShaderVulkanTest, PipelineCacheData)
+{
+	const VkInstanceCreateInfo instanceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO, // sType
+		nullptr, // pNext
+		0,       // flags
+		nullptr, // pApplicationInfo
+		0,       // enabledLayerCount
+		nullptr, // ppEnabledLayerNames
+		0,       // enabledExtensionCount
+		nullptr, // ppEnabledExtensionNames
+	};
+	VkInstance instance = VK_NULL_HANDLE;
+	VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	uint32_t pPhysicalDeviceCount = 1;
+	VkPhysicalDevice pPhysicalDevice = VK_NULL_HANDLE;
+	result = vkEnumeratePhysicalDevices(instance, &pPhysicalDeviceCount, &pPhysicalDevice);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(pPhysicalDevice, &physicalDeviceProperties);
+
+	const float queuePriority = 1.0f;
+	const VkDeviceQueueCreateInfo queueCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, // sType
+		nullptr,        // pNext
+		0,              // flags
+		0,              // queueFamilyIndex
+		1,              // queueCount
+		&queuePriority, // pQueuePriorities
+	};
+	const VkDeviceCreateInfo deviceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO, // sType
+		nullptr,          // pNext
+		0,                // flags
+		1,                // queueCreateInfoCount
+		&queueCreateInfo, // pQueueCreateInfos
+		0,                // enabledLayerCount
+		nullptr,          // ppEnabledLayerNames
+		0,                // enabledExtensionCount
+		nullptr,          // ppEnabledExtensionNames
+		nullptr,          // pEnabledFeatures
+	};
+	VkDevice device = VK_NULL_HANDLE;
+	result = vkCreateDevice(pPhysicalDevice, &deviceCreateInfo, nullptr, &device);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	// Compute shader with an empty main function
+	const uint32_t code[] =
+	{
+		0x07230203, 0x00010000, 0, 6, 0,     // Header
+		0x00020011, 1,                       // OpCapability Shader
+		0x0003000E, 0, 1,                    // OpMemoryModel Logical GLSL450
+		0x0005000F, 5, 4, 0x6E69616D, 0,     // OpEntryPoint GLCompute %4 "main"
+		0x00060010, 4, 17, 1, 1, 1,          // OpExecutionMode %4 LocalSize 1 1 1
+		0x00020013, 2,                       // %2 = OpTypeVoid
+		0x00030021, 3, 2,                    // %3 = OpTypeFunction %2
+		0x00050036, 2, 4, 0, 3,              // %4 = OpFunction %2 None %3
+		0x000200F8, 5,                       // %5 = OpLabel
+		0x000100FD,                          // OpReturn
+		0x00010038,                          // OpFunctionEnd
+	};
+	const VkShaderModuleCreateInfo shaderModuleCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, // sType
+		nullptr,      // pNext
+		0,            // flags
+		sizeof(code), // codeSize
+		code,         // pCode
+	};
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	result = vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, // sType
+		nullptr, // pNext
+		0,       // flags
+		0,       // setLayoutCount
+		nullptr, // pSetLayouts
+		0,       // pushConstantRangeCount
+		nullptr, // pPushConstantRanges
+	};
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	result = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, // sType
+		nullptr, // pNext
+		0,       // flags
+		0,       // initialDataSize
+		nullptr, // pInitialData
+	};
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	// Creating a pipeline through the cache adds its shader module to it
+	const VkComputePipelineCreateInfo computePipelineCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO, // sType
+		nullptr, // pNext
+		0,       // flags
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, // sType
+			nullptr,                     // pNext
+			0,                           // flags
+			VK_SHADER_STAGE_COMPUTE_BIT, // stage
+			shaderModule,                // module
+			"main",                      // pName
+			nullptr,                     // pSpecializationInfo
+		},
+		pipelineLayout, // layout
+		VK_NULL_HANDLE, // basePipelineHandle
+		-1,             // basePipelineIndex
+	};
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	result = vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	// The header is followed by a hash and word count for each entry, and then its code
+	const size_t headerSize = 16 + VK_UUID_SIZE;
+	const size_t entrySize = 2 * sizeof(uint64_t) + sizeof(code);
+
+	size_t dataSize = 0;
+	result = vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+	EXPECT_EQ(result, VK_SUCCESS);
+	EXPECT_EQ(dataSize, headerSize + entrySize);
+
+	std::vector<uint8_t> data(dataSize);
+	result = vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data());
+	EXPECT_EQ(result, VK_SUCCESS);
+	EXPECT_EQ(dataSize, headerSize + entrySize);
+
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+	EXPECT_EQ(header[0], headerSize);
+	EXPECT_EQ(header[1], VK_PIPELINE_CACHE_HEADER_VERSION_ONE);
+	EXPECT_EQ(header[2], physicalDeviceProperties.vendorID);
+	EXPECT_EQ(header[3], physicalDeviceProperties.deviceID);
+	EXPECT_EQ(memcmp(data.data() + 16, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE), 0);
+	EXPECT_EQ(memcmp(data.data() + dataSize - sizeof(code), code, sizeof(code)), 0);
+
+	// Only whole entries are written when the buffer is too small
+	std::vector<uint8_t> truncated(data.size());
+	size_t truncatedSize = data.size() - 1;
+	result = vkGetPipelineCacheData(device, pipelineCache, &truncatedSize, truncated.data());
+	EXPECT_EQ(result, VK_INCOMPLETE);
+	EXPECT_EQ(truncatedSize, headerSize);
+	EXPECT_EQ(memcmp(truncated.data(), data.data(), headerSize), 0);
+
+	truncatedSize = headerSize - 1;
+	result = vkGetPipelineCacheData(device, pipelineCache, &truncatedSize, truncated.data());
+	EXPECT_EQ(result, VK_INCOMPLETE);
+	EXPECT_EQ(truncatedSize, 0u);
+
+	// The data restores the same cache contents
+	pipelineCacheCreateInfo.initialDataSize = data.size();
+	pipelineCacheCreateInfo.pInitialData = data.data();
+	VkPipelineCache restoredCache = VK_NULL_HANDLE;
+	result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &restoredCache);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	std::vector<uint8_t> restored(data.size());
+	size_t restoredSize = restored.size();
+	result = vkGetPipelineCacheData(device, restoredCache, &restoredSize, restored.data());
+	EXPECT_EQ(result, VK_SUCCESS);
+	EXPECT_EQ(restoredSize, data.size());
+	EXPECT_EQ(restored, data);
+
+	// Data for a different device is ignored
+	data[16] ^= 0xFF;
+	VkPipelineCache mismatchedCache = VK_NULL_HANDLE;
+	result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &mismatchedCache);
+	EXPECT_EQ(result, VK_SUCCESS);
+
+	size_t mismatchedSize = 0;
+	result = vkGetPipelineCacheData(device, mismatchedCache, &mismatchedSize, nullptr);
+	EXPECT_EQ(result, VK_SUCCESS);
+	EXPECT_EQ(mismatchedSize, headerSize);
+
+	vkDestroyPipelineCache(device, mismatchedCache, nullptr);
+	vkDestroyPipelineCache(device, restoredCache, nullptr);
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+}